@@ -2,6 +2,21 @@
  * PHDataSupplier:
  *    Supplies app-specific data to the WebThing DataBroker
  *
+ * NOTES:
+ * o Keys are resolved through a perfect hash table that is built at compile
+ *   time (see src/util/PerfectHash.h). Every key costs the same to look up:
+ *   one hash, one slot load, and one string compare. The table and the
+ *   entries, including the key text, are in PROGMEM so they take no RAM on
+ *   the ESP8266.
+ * o Each entry carries the function that produces its value so no work is
+ *   done for keys other than the one being requested.
+ * o Values are written into a stack buffer by a Writer rather than built
+ *   up as Strings. That is not the same as no heap use, which hasn't been
+ *   measured on the device: the result is copied into the DataBroker's
+ *   String, and a lookup that finds the AQIValueCache stale refills it,
+ *   which formats the timestamp through a temporary String.
+ * o The keys and what they mean are listed in the README (Plugin Data).
+ *
  */
 
 //--------------- Begin:  Includes ---------------------------------------------
@@ -12,30 +27,185 @@
 //                                  Local Includes
 #include "PurpleHazeApp.h"
 #include "PHDataSupplier.h"
+#include "src/util/PerfectHash.h"
+#include "src/util/Writer.h"
 //--------------- End:    Includes ---------------------------------------------
 
 
 namespace PHDataSupplier {
 
+  // ----- BEGIN: PHDataSupplier::Internal
+  namespace Internal {
+    using ValueFn = void (*)(uint8_t arg, Writer& out);
+
+    constexpr size_t MaxValueLength = 32;   // Longest value is a formatted time
+    constexpr size_t MaxKeyLength = 20;     // Longest key is health.pms.checksum
+
+    struct Entry {
+      char key[MaxKeyLength];
+      ValueFn value;
+      uint8_t arg;
+    };
+
+    void cached(uint8_t field, Writer& out) {
+      out.print(phApp->aqiValues.value((AQIValueCache::Field)field));
+    }
+
+    enum CacheStat : uint8_t { Hits, Misses, Fills };
+    void cacheStat(uint8_t which, Writer& out) {
+      const AQIValueCache::Stats& stats = phApp->aqiValues.stats();
+      switch (which) {
+        case Hits:   out.printUInt(stats.hits); break;
+        case Misses: out.printUInt(stats.misses); break;
+        case Fills:  out.printUInt(stats.fills); break;
+      }
+    }
+
+    enum SerialStat : uint8_t { Frames, ChecksumErrors, SyncErrors, Overflow };
+    void serialStat(uint8_t which, Writer& out) {
+      SecondarySerial::Stats stats = phApp->streamToSensor.stats();
+      switch (which) {
+        case Frames:          out.printUInt(stats.framesAccepted); break;
+        case ChecksumErrors:  out.printUInt(stats.checksumErrors); break;
+        case SyncErrors:      out.printUInt(stats.syncErrors); break;
+        case Overflow:        out.printUInt(stats.overflowBytes); break;
+      }
+    }
+
+    enum SensorStat : uint8_t { Sensors, Faults };
+    void sensorStat(uint8_t which, Writer& out) {
+      if (which == Sensors) out.printUInt(phApp->streamToSensor.sensors.size());
+      else out.printUInt(phApp->streamToSensor.faults(millis()));
+    }
+
+    // Statistics for PM2.5 (env) over the last aggregation interval
+    enum AggStat : uint8_t { Mean, Min, Max, Median, AggFrames, AggInterval };
+    void aggStat(uint8_t which, Writer& out) {
+      const FrameAggregator::Summary& s = phApp->aqiAggregator.summary();
+      switch (which) {
+        case Mean:      out.printUInt(s.mean.env.pm25); break;
+        case Min:       out.printUInt(s.min.env.pm25); break;
+        case Max:       out.printUInt(s.max.env.pm25); break;
+        case Median:    out.printUInt(s.median.env.pm25); break;
+        case AggFrames: out.printUInt(s.frames); break;
+        case AggInterval: out.printUInt(phApp->aqiAggregator.getInterval()); break;
+      }
+    }
+
+    void epaPM25(uint8_t, Writer& out) {
+      uint16_t epa = phApp->pmHumidity.latest();
+      if (epa != PMHumidityJoin::NoValue) out.printFixed(epa, 1);
+      else out.print("N/A");
+    }
+
+    void nowCastPM25(uint8_t, Writer& out) {
+      const NowCast& nc = phApp->nowCast;
+      if (nc.available()) out.printFixed(nc.pm25x10(), 1);
+      else out.print("N/A");
+    }
+
+    enum HealthStat : uint8_t { FPS, Checksum, Resyncs, FrameAge };
+    void pmsHealth(uint8_t which, Writer& out) {
+      const SecondarySerial& serial = phApp->streamToSensor;
+      uint32_t curMillis = millis();
+      for (uint8_t i = 0; i < SecondarySerial::NSensors; i++) {
+        if (i) out.print(',');
+        switch (which) {
+          case FPS:       out.printFloat(serial.frameRate(i), 2); break;
+          case Checksum:  out.printUInt(serial.stats(i).checksumErrors); break;
+          case Resyncs:   out.printUInt(serial.stats(i).resyncs); break;
+          case FrameAge: {
+            uint32_t age = serial.frameAge(i, curMillis);
+            if (age == UINT32_MAX) out.print("N/A"); else out.printUInt(age / 1000);
+            break;
+          }
+        }
+      }
+    }
+
+    enum WeatherHealthStat : uint8_t { Failures, ReadMicros, MaxReadMicros, SampleAge };
+    void weatherHealth(uint8_t which, Writer& out) {
+      const WeatherSampler& sampler = phApp->weatherSampler;
+      if (which == SampleAge) {
+        uint32_t sampled = sampler.latest().timestamp;
+        if (sampled) out.printUInt((millis() - sampled) / 1000); else out.print("N/A");
+        return;
+      }
+      bool first = true;
+      for (uint8_t d = 0; d < WeatherSampler::NDevices; d++) {
+        if (!WeatherSampler::has((WeatherSampler::Device)d)) continue;
+        const WeatherSampler::Health& h = sampler.health((WeatherSampler::Device)d);
+        if (!first) out.print(',');
+        switch (which) {
+          case Failures:      out.printUInt(h.failures); break;
+          case ReadMicros:    out.printUInt(h.lastMicros); break;
+          case MaxReadMicros: out.printUInt(h.maxMicros); break;
+        }
+        first = false;
+      }
+    }
+
+    constexpr Entry Entries[] PROGMEM = {
+      {"aqi",      cached, AQIValueCache::AQI},
+      {"pm10std",  cached, AQIValueCache::PM10Std},
+      {"pm25std",  cached, AQIValueCache::PM25Std},
+      {"pm100std", cached, AQIValueCache::PM100Std},
+      {"pm10env",  cached, AQIValueCache::PM10Env},
+      {"pm25env",  cached, AQIValueCache::PM25Env},
+      {"pm100env", cached, AQIValueCache::PM100Env},
+      {"p03",      cached, AQIValueCache::P03},
+      {"p05",      cached, AQIValueCache::P05},
+      {"p10",      cached, AQIValueCache::P10},
+      {"p25",      cached, AQIValueCache::P25},
+      {"p50",      cached, AQIValueCache::P50},
+      {"p100",     cached, AQIValueCache::P100},
+      {"tmst",     cached, AQIValueCache::Timestamp},
+      {"cache.hits",    cacheStat, Hits},
+      {"cache.misses",  cacheStat, Misses},
+      {"cache.fills",   cacheStat, Fills},
+      {"serial.frames",   serialStat, Frames},
+      {"serial.checksum", serialStat, ChecksumErrors},
+      {"serial.sync",     serialStat, SyncErrors},
+      {"serial.overflow", serialStat, Overflow},
+      {"pms.sensors",     sensorStat, Sensors},
+      {"pms.faults",      sensorStat, Faults},
+      {"pm25.mean",   aggStat, Mean},
+      {"pm25.min",    aggStat, Min},
+      {"pm25.max",    aggStat, Max},
+      {"pm25.median", aggStat, Median},
+      {"pm25.epa",    epaPM25, 0},
+      {"agg.frames",  aggStat, AggFrames},
+      {"agg.interval", aggStat, AggInterval},
+      {"nowcast",      cached, AQIValueCache::NowCastAQI},
+      {"nowcast.pm25", nowCastPM25, 0},
+      {"health.pms.fps",      pmsHealth, FPS},
+      {"health.pms.checksum", pmsHealth, Checksum},
+      {"health.pms.resyncs",  pmsHealth, Resyncs},
+      {"health.pms.age",      pmsHealth, FrameAge},
+      {"health.wx.failures",  weatherHealth, Failures},
+      {"health.wx.us",        weatherHealth, ReadMicros},
+      {"health.wx.maxus",     weatherHealth, MaxReadMicros},
+      {"health.wx.age",       weatherHealth, SampleAge}
+    };
+
+    // If you add a key and the static_assert fires, try another seed
+    constexpr uint32_t Seed = PerfectHash::FNVOffset + 487;
+    constexpr auto Keys PROGMEM = PerfectHash::makeTable<128>(Entries, Seed);
+    static_assert(Keys.isPerfect(), "PHDataSupplier keys collide; choose a new Seed");
+  }
+  // ----- END: PHDataSupplier::Internal
+
+
   // CUSTOM: If your app has a custom data source, publish that data to
   // plugins by implementing a data supplier that maps keys to values.
   // In this case we publish the data from the sensors
   void dataSupplier(const String& key, String& val) {
-    const AQIReadings& aqiReadings = phApp->aqiMgr.getLastReadings();
-    if (key == "aqi")           val.concat(phApp->aqiMgr.derivedAQI(aqiReadings.env.pm25));
-    else if (key == "pm10std")  val.concat(aqiReadings.standard.pm10);
-    else if (key == "pm25std")  val.concat(aqiReadings.standard.pm25);
-    else if (key == "pm100std") val.concat(aqiReadings.standard.pm100);
-    else if (key == "pm10env")  val.concat(aqiReadings.env.pm10);
-    else if (key == "pm25env")  val.concat(aqiReadings.env.pm25);
-    else if (key == "pm100env") val.concat(aqiReadings.env.pm100);
-    else if (key == "p03")      val.concat(aqiReadings.particles_03um);
-    else if (key == "p05")      val.concat(aqiReadings.particles_05um);
-    else if (key == "p10")      val.concat(aqiReadings.particles_10um);
-    else if (key == "p25")      val.concat(aqiReadings.particles_25um);
-    else if (key == "p50")      val.concat(aqiReadings.particles_50um);
-    else if (key == "p100")     val.concat(aqiReadings.particles_100um);
-    else if (key == "tmst")     val = Output::formattedTime(Basics::wallClockFromMillis(aqiReadings.timestamp));
+    Internal::Entry e;
+    if (!Internal::Keys.find(key.c_str(), e)) return;
+    char buf[Internal::MaxValueLength];
+    Writer out(buf, sizeof(buf));
+    e.value(e.arg, out);
+    val.concat(out.c_str(), out.length());
   }
 }
 
@@ -14,12 +14,12 @@
 //                                  WebThing Includes
 #include <plugins/PluginMgr.h>
 #include <gui/ScreenMgr.h>
-#include <screens/oled/SensorGraphScreen.h>
 //                                  Local Includes
 #include "src/screens/SplashScreen.h"
 #include "src/screens/HomeScreen.h"
 #include "src/screens/AQIScreen.h"
 #include "src/screens/ReadingScreen.h"
+#include "src/screens/HistoryGraphScreen.h"
 //--------------- End:    Includes ---------------------------------------------
 
 
@@ -29,10 +29,10 @@ public:
   HomeScreen*         homeScreen;
 #if defined(HAS_AQI_SENSOR)
   AQIScreen*          aqiScreen;
-  AQIGraphScreen*     aqiGraphScreen;
+  HistoryGraphScreen* aqiGraphScreen;
 #endif
 #if defined(HAS_WEATHER_SENSOR)
-  WeatherGraphScreen*	weatherGraphScreen;
+  HistoryGraphScreen*	weatherGraphScreen;
   TempScreen* 				tempScreen;
   HumidityScreen* 		humiScreen;
   BaroScreen* 				baroScreen;
@@ -54,18 +54,17 @@ public:
 
 #if defined(HAS_AQI_SENSOR)
 	  aqiScreen = new AQIScreen();
-	  aqiGraphScreen = new AQIGraphScreen(aqiMgr);
+	  aqiGraphScreen = new HistoryGraphScreen(HistoryGraphScreen::Value::AQI);
 	  ScreenMgr.registerScreen("AQI", aqiScreen);
 	  ScreenMgr.registerScreen("AQI-Graph", aqiGraphScreen);
-	  aqiGraphScreen->selectBuffer(settings->aqiSettings.graphRange);
-#else
-	  (void)aqiMgr;
+	  aqiGraphScreen->selectRange(settings->aqiSettings.graphRange);
 #endif
+	  (void)aqiMgr;
 #if defined(HAS_WEATHER_SENSOR)
 	  if (weatherReadings && READ_TEMP) {
 	  	tempScreen = new TempScreen();
-  	  weatherGraphScreen = new WeatherGraphScreen(weatherMgr);
-		  weatherGraphScreen->selectBuffer(settings->weatherSettings.graphRange);
+  	  weatherGraphScreen = new HistoryGraphScreen(HistoryGraphScreen::Value::Temp);
+		  weatherGraphScreen->selectRange(settings->weatherSettings.graphRange);
 		  ScreenMgr.registerScreen("Temp", tempScreen);
 		  ScreenMgr.registerScreen("Temp-Graph", weatherGraphScreen);
 		}
@@ -20,17 +20,13 @@
 
 
 void WeatherSettings::fromJSON(const JsonDocument &doc) {
-  tempCorrection = doc["wthr"]["tempCorrection"];
-  humiCorrection = doc["wthr"]["humiCorrection"];
   chartColors.temp = String(doc["wthr"]["chartColors"]["temp"]|"#4e7a27");
   chartColors.humi = String(doc["wthr"]["chartColors"]["humi"]|"#ff00ff");
   graphRange = doc["wthr"]["graphRange"];
-  graphRange = (graphRange > 2) ? 2 : graphRange;
+  graphRange = (graphRange > 4) ? 4 : graphRange;  // Hour, Day, Week, Month, Year
 }
 
 void WeatherSettings::toJSON(JsonDocument &doc) {
-  doc["wthr"]["tempCorrection"] = tempCorrection;
-  doc["wthr"]["humiCorrection"] = humiCorrection;
   doc["wthr"]["chartColors"]["temp"] = chartColors.temp;
   doc["wthr"]["chartColors"]["humi"] = chartColors.humi;
   doc["wthr"]["graphRange"] = graphRange;
@@ -38,8 +34,6 @@ void WeatherSettings::toJSON(JsonDocument &doc) {
 
 void WeatherSettings::logSettings() {
   Log.verbose(F("Weather Settings"));
-  Log.verbose(F("  tempCorrection = %F"), tempCorrection);
-  Log.verbose(F("  humiCorrection = %F"), humiCorrection);
   Log.verbose(F("  chartColors.temp = %s"), chartColors.temp.c_str());
   Log.verbose(F("  chartColors.humi = %s"), chartColors.humi.c_str());
   Log.verbose(F("  Graph Range = %d"), graphRange);
@@ -48,25 +42,64 @@ void WeatherSettings::logSettings() {
 void AQISettings::fromJSON(const JsonDocument &doc) {
   chartColors.aqi = String(doc["aqi"]["chartColors"]["aqi"]|"#f00f88");
   graphRange = doc["aqi"]["graphRange"];
-  graphRange = (graphRange > 2) ? 2 : graphRange;
+  graphRange = (graphRange > 4) ? 4 : graphRange;  // Hour, Day, Week, Month, Year
+  useNowCast = doc["aqi"]["useNowCast"];
 }
 
 void AQISettings::toJSON(JsonDocument &doc) {
   doc["aqi"]["chartColors"]["aqi"] = chartColors.aqi;
   doc["aqi"]["graphRange"] = graphRange;
+  doc["aqi"]["useNowCast"] = useNowCast;
 }
 
 void AQISettings::logSettings() {
   Log.verbose(F("AQI Settings"));
   Log.verbose(F("  chartColors.aqi = %s"), chartColors.aqi.c_str());
   Log.verbose(F("  Graph Range = %d"), graphRange);
+  Log.verbose(F("  useNowCast = %T"), useNowCast);
+}
+
+void CalibrationSettings::applyTo(Calibration& cal) const {
+  for (uint8_t i = 0; i < Calibration::NChannels; i++) {
+    cal.set((Calibration::Channel)i, gain[i], offset[i]);
+  }
+}
+
+void CalibrationSettings::fromJSON(const JsonDocument &doc) {
+  if (doc["cal"].isNull()) {
+    gain[Calibration::Temp] = gain[Calibration::Humi] = 1.0;
+    offset[Calibration::Temp] = doc["wthr"]["tempCorrection"];
+    offset[Calibration::Humi] = doc["wthr"]["humiCorrection"];
+    return;
+  }
+  for (uint8_t i = 0; i < Calibration::NChannels; i++) {
+    const char* name = Calibration::name((Calibration::Channel)i);
+    gain[i] = doc["cal"][name]["gain"] | 1.0f;
+    offset[i] = doc["cal"][name]["offset"] | 0.0f;
+  }
+}
+
+void CalibrationSettings::toJSON(JsonDocument &doc) {
+  for (uint8_t i = 0; i < Calibration::NChannels; i++) {
+    const char* name = Calibration::name((Calibration::Channel)i);
+    doc["cal"][name]["gain"] = gain[i];
+    doc["cal"][name]["offset"] = offset[i];
+  }
+}
+
+void CalibrationSettings::logSettings() {
+  Log.verbose(F("Calibration Settings"));
+  for (uint8_t i = 0; i < Calibration::NChannels; i++) {
+    Log.verbose(F("  %s: gain = %F, offset = %F"),
+      Calibration::name((Calibration::Channel)i), gain[i], offset[i]);
+  }
 }
 
 
 
 PHSettings::PHSettings() {
   version = PHSettings::CurrentVersion;
-  maxFileSize = 2048;
+  maxFileSize = 3072;  // Room for the calibration settings
 }
 
 void PHSettings::fromJSON(const JsonDocument &doc) {
@@ -79,6 +112,7 @@ void PHSettings::fromJSON(const JsonDocument &doc) {
 
   aqiSettings.fromJSON(doc);
   weatherSettings.fromJSON(doc);
+  calibration.fromJSON(doc);
   WTAppSettings::fromJSON(doc);
 }
 
@@ -91,6 +125,7 @@ void PHSettings::toJSON(JsonDocument &doc) {
 
   aqiSettings.toJSON(doc);
   weatherSettings.toJSON(doc);
+  calibration.toJSON(doc);
   WTAppSettings::toJSON(doc);
 }
 
@@ -103,6 +138,7 @@ void PHSettings::logSettings() {
   Log.verbose(F("  indicator brightness: %d"), iBright);
   aqiSettings.logSettings();
   weatherSettings.logSettings();
+  calibration.logSettings();
   WTAppSettings::logSettings();
 }
 
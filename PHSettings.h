@@ -13,13 +13,12 @@
 //                                  Third Party Libraries
 #include <WTAppSettings.h>
 //                                  Local Includes
+#include "src/data/Calibration.h"
 //--------------- End:    Includes ---------------------------------------------
 
 
 class WeatherSettings {
 public:
-  float   tempCorrection = 0.0; // Correction to the temp reading - always in Celsius
-  float   humiCorrection = 0.0; // Correction to the humidty sensor reading
   struct {
     String temp = "#ff00ff";
     String humi = "#4e7a27";
@@ -36,6 +35,20 @@ public:
     String aqi = "#f00f88";
   } chartColors;
   uint8_t graphRange = 0;
+  bool useNowCast = false;  // Report the NowCast AQI rather than the instantaneous AQI
+  void fromJSON(const JsonDocument &doc);
+  void toJSON(JsonDocument &doc);
+  void logSettings();
+};
+
+class CalibrationSettings {
+public:
+  // Offsets are in the channel's unit; temperature is always in Celsius.
+  // The temperature and humidity offsets replace the old tempCorrection
+  // and humiCorrection, which are read if no calibration has been saved.
+  float gain[Calibration::NChannels] = {1.0, 1.0, 1.0, 1.0, 1.0, 1.0};
+  float offset[Calibration::NChannels] = {};
+  void applyTo(Calibration& cal) const;
   void fromJSON(const JsonDocument &doc);
   void toJSON(JsonDocument &doc);
   void logSettings();
@@ -60,6 +73,7 @@ public:
   
   AQISettings aqiSettings;
   WeatherSettings weatherSettings;
+  CalibrationSettings calibration;
 
 private:
   // ----- Constants -----
@@ -22,6 +22,10 @@
 #include "src/hardware/HWConfig.h"
 #include "PurpleHazeApp.h"
 #include "PHWebUI.h"
+#include "src/web/PageTemplate.h"
+#include "src/util/VarInt.h"
+#include "src/history/Downsampler.h"
+#include "src/web/EventStream.h"
 //--------------- End:    Includes ---------------------------------------------
 
 
@@ -49,176 +53,663 @@ namespace PHWebUI {
       else phApp->busyIndicator->off();
       WebUIHelper::showBusyStatus(busy);
     }
+
+    // Parses the arguments of a history request that is served from the
+    // app's history rather than the sensor managers: one that asks only for
+    // samples newer than "since", that asks for the binary format, or that
+    // asks for a range the sensor managers don't keep (month or year).
+    // Returns false if this is not such a request.
+    bool appHistoryRequest(History::Range& range, uint32_t& since, bool& binary) {
+      String sinceArg = WebUI::arg("since");
+      binary = WebUI::arg("format").equalsIgnoreCase("bin");
+      String rangeArg = WebUI::arg("range");
+      if (rangeArg.equalsIgnoreCase("hour")) range = History::Hour;
+      else if (rangeArg.equalsIgnoreCase("day")) range = History::Day;
+      else if (rangeArg.equalsIgnoreCase("week")) range = History::Week;
+      else if (rangeArg.equalsIgnoreCase("month")) range = History::Month;
+      else if (rangeArg.equalsIgnoreCase("year")) range = History::Year;
+      else return false;
+      if (sinceArg.isEmpty() && !binary && range < History::NLiveRanges) return false;
+      since = strtoul(sinceArg.c_str(), nullptr, 10);
+      return true;
+    }
+
+    // A request for the samples in a window of time rather than a range
+    struct HistoryWindow {
+      uint32_t start;
+      uint32_t end;
+      uint16_t points;    // The most samples wanted, 0 for all of them
+    };
+
+    // Parses the start, end, and points arguments of a history request.
+    // Returns false if there is no start.
+    bool windowRequest(HistoryWindow& w) {
+      String startArg = WebUI::arg("start");
+      if (startArg.isEmpty()) return false;
+      String endArg = WebUI::arg("end");
+      w.start = strtoul(startArg.c_str(), nullptr, 10);
+      w.end = endArg.isEmpty() ? UINT32_MAX : strtoul(endArg.c_str(), nullptr, 10);
+      w.points = constrain(WebUI::arg("points").toInt(), 0L, (long)UINT16_MAX);
+      return true;
+    }
+
+    bool aqiValue(const History::Sample& s, int32_t& v) {
+      if (s.aqi == History::NoAQI) return false;
+      v = s.aqi;
+      return true;
+    }
+
+    bool tempValue(const History::Sample& s, int32_t& v) {
+      if (s.temp == History::NoTemp) return false;
+      v = s.temp;
+      return true;
+    }
+
+    // The samples of a window, from the finest range that reaches back to its
+    // start, downsampled on the given value
+    Downsampler windowSamples(const HistoryWindow& w, Downsampler::ValueFn value) {
+      const History& h = phApp->history;
+      return Downsampler(h, h.rangeReaching(w.start), w.start, w.end, w.points, value);
+    }
+
+    // Emits the samples that source (a History::Cursor or a Downsampler)
+    // returns. The output has the same form as AQIMgr::emitHistoryAsJson and
+    // WeatherMgr::emitHistoryAsJson, with the extremes of each sample's
+    // period and the number of readings (n) added.
+    template <typename Source> void emitAQISamples(Source& source, Stream& s) {
+      char buf[104];
+      bool first = true;
+      s.print("{\"history\":[");
+      History::Sample sample;
+      while (source.next(sample)) {
+        if (sample.aqi == History::NoAQI) continue;
+        Writer out(buf, sizeof(buf));
+        if (!first) out.print(',');
+        out.print("{\"ts\":").printUInt(sample.ts);
+        out.print(",\"aqi\":").printUInt(sample.aqi);
+        out.print(",\"min\":").printUInt(sample.aqiMin);
+        out.print(",\"max\":").printUInt(sample.aqiMax);
+        if (sample.nowCast != History::NoAQI) out.print(",\"nc\":").printUInt(sample.nowCast);
+        if (sample.pm25 != History::NoPM) out.print(",\"pm25\":").printFixed(sample.pm25, 1);
+        if (sample.pm25Epa != History::NoPM) out.print(",\"epa\":").printFixed(sample.pm25Epa, 1);
+        out.print(",\"n\":").printUInt(sample.count);
+        out.print('}');
+        s.write(out.c_str(), out.length());
+        first = false;
+      }
+      s.print("]}");
+    }
+
+    template <typename Source> void emitWeatherSamples(Source& source, Stream& s) {
+      char buf[128];
+      bool first = true;
+      s.print("{\"history\":[");
+      History::Sample sample;
+      while (source.next(sample)) {
+        if (sample.temp == History::NoTemp) continue;
+        Writer out(buf, sizeof(buf));
+        if (!first) out.print(',');
+        out.print("{\"ts\":").printUInt(sample.ts);
+        out.print(",\"t\":").printFixed(sample.temp, 1);
+        out.print(",\"tMin\":").printFixed(sample.tempMin, 1);
+        out.print(",\"tMax\":").printFixed(sample.tempMax, 1);
+        if (sample.humi != History::NoHumi) {
+          out.print(",\"h\":").printFixed(sample.humi, 1);
+          out.print(",\"hMin\":").printFixed(sample.humiMin, 1);
+          out.print(",\"hMax\":").printFixed(sample.humiMax, 1);
+        }
+        if (sample.pressure != History::NoPressure) out.print(",\"p\":").printFixed(sample.pressure, 1);
+        out.print(",\"n\":").printUInt(sample.count);
+        out.print('}');
+        s.write(out.c_str(), out.length());
+        first = false;
+      }
+      s.print("]}");
+    }
+
+    // Emits the samples in the given range that are newer than since
+    void emitAQIHistory(History::Range range, uint32_t since, Stream& s) {
+      History::Cursor c = phApp->history.samplesAfter(range, since);
+      emitAQISamples(c, s);
+    }
+
+    void emitWeatherHistory(History::Range range, uint32_t since, Stream& s) {
+      History::Cursor c = phApp->history.samplesAfter(range, since);
+      emitWeatherSamples(c, s);
+    }
+
+    // Fields that may be included in a binary history response
+    enum HistoryField : uint8_t {
+      AQIField = 0x01, TempField = 0x02, HumiField = 0x04, NowCastField = 0x08,
+      AQIRangeField = 0x10, TempRangeField = 0x20, HumiRangeField = 0x40 };
+
+    // Buffers varints so they reach the Stream in reasonably sized blocks
+    class BinWriter {
+    public:
+      BinWriter(Stream& s) : s(s) { }
+      ~BinWriter() { if (n) s.write(buf, n); }
+
+      void put(uint32_t v) { reserve(); n += VarInt::put(buf+n, v); }
+      void putSigned(int32_t v) { reserve(); n += VarInt::putSigned(buf+n, v); }
+
+    private:
+      Stream& s;
+      uint8_t buf[128];
+      size_t n = 0;
+
+      void reserve() {
+        if (n > sizeof(buf) - VarInt::MaxBytes) { s.write(buf, n); n = 0; }
+      }
+    };
+
+    // Emits the samples that newSource() returns (each call must return a
+    // fresh History::Cursor or Downsampler over the same samples) that have a
+    // value for at least one of the requested fields. The form is:
+    //    varint  period of the samples in seconds
+    //    varint  sample count
+    //    For each sample:
+    //      varint  timestamp/period for the first sample, then the number of
+    //              periods since the previous sample
+    //      varint  the fields present in this sample. Omitted if only one
+    //              field was requested since it must then be present.
+    //      For each present field, in the order AQI, temp, humidity, NowCast:
+    //              zigzag varint change from the previous value of that field
+    //              (starting at 0). Temp and humidity are in tenths.
+    //      For each present range field, in the order AQI, temp, humidity:
+    //              varint  the average less the minimum
+    //              varint  the maximum less the average
+    // The layout is decoded by decodeHistory() in ChartPage.html.
+    template <typename SourceFn>
+    void emitSamplesBin(uint32_t period, uint8_t fields, SourceFn newSource, BinWriter& out) {
+      const bool singleField = (fields & (fields - 1)) == 0;
+
+      auto present = [fields](const History::Sample& sample) -> uint8_t {
+        uint8_t p = 0;
+        if (sample.aqi != History::NoAQI) p |= AQIField;
+        if (sample.temp != History::NoTemp) p |= TempField;
+        if (sample.humi != History::NoHumi) p |= HumiField;
+        if (sample.nowCast != History::NoAQI) p |= NowCastField;
+        // Extremes are present exactly when their averages are
+        if (p & AQIField) p |= AQIRangeField;
+        if (p & TempField) p |= TempRangeField;
+        if (p & HumiField) p |= HumiRangeField;
+        return p & fields;
+      };
+
+      // Decoding is cheap, so the samples are decoded once to count them and
+      // again to emit them
+      History::Sample sample;
+      uint32_t count = 0;
+      auto counter = newSource();
+      while (counter.next(sample)) {
+        if (present(sample)) count++;
+      }
+      out.put(period);
+      out.put(count);
+
+      uint32_t prevPeriods = 0;
+      int32_t prevAQI = 0, prevTemp = 0, prevHumi = 0, prevNowCast = 0;
+      auto c = newSource();
+      while (c.next(sample)) {
+        uint8_t p = present(sample);
+        if (!p) continue;
+        uint32_t periods = sample.ts / period;
+        out.put(periods - prevPeriods);
+        prevPeriods = periods;
+        if (!singleField) out.put(p);
+        if (p & AQIField)  { out.putSigned(sample.aqi - prevAQI); prevAQI = sample.aqi; }
+        if (p & TempField) { out.putSigned(sample.temp - prevTemp); prevTemp = sample.temp; }
+        if (p & HumiField) { out.putSigned(sample.humi - prevHumi); prevHumi = sample.humi; }
+        if (p & NowCastField) { out.putSigned(sample.nowCast - prevNowCast); prevNowCast = sample.nowCast; }
+        if (p & AQIRangeField) { out.put(sample.aqi - sample.aqiMin); out.put(sample.aqiMax - sample.aqi); }
+        if (p & TempRangeField) { out.put(sample.temp - sample.tempMin); out.put(sample.tempMax - sample.temp); }
+        if (p & HumiRangeField) { out.put(sample.humi - sample.humiMin); out.put(sample.humiMax - sample.humi); }
+      }
+    }
+
+    // Emits the samples in the given range that are newer than since
+    void emitRangeBin(History::Range range, uint32_t since, uint8_t fields, BinWriter& out) {
+      const History& h = phApp->history;
+      emitSamplesBin(
+          h.period(range), fields, [&]() { return h.samplesAfter(range, since); }, out);
+    }
+
+    // Emits the samples of a window, downsampled on the given value
+    void emitWindowBin(
+        const HistoryWindow& w, Downsampler::ValueFn value, uint8_t fields, Stream& s)
+    {
+      const History& h = phApp->history;
+      History::Range range = h.rangeReaching(w.start);
+      BinWriter out(s);
+      emitSamplesBin(h.period(range), fields, [&]() {
+        return Downsampler(h, range, w.start, w.end, w.points, value);
+      }, out);
+    }
+
+    void emitHistoryBin(History::Range range, uint32_t since, uint8_t fields, Stream& s) {
+      BinWriter out(s);
+      emitRangeBin(range, since, fields, out);
+    }
+
+    // The history fields this device can supply
+    uint8_t availableFields() {
+      uint8_t fields = 0;
+      #if defined(HAS_AQI_SENSOR)
+        fields |= AQIField | NowCastField | AQIRangeField;
+      #endif
+      #if defined(HAS_WEATHER_SENSOR)
+        if (phApp->weatherMgr.hasTemp()) fields |= TempField | TempRangeField;
+        if (phApp->weatherMgr.hasHumi()) fields |= HumiField | HumiRangeField;
+      #endif
+      return fields;
+    }
+
+    // Emits the sensors' health counters as JSON. These are the same values
+    // that are published as $Q.health.*. Ages are in ms and are null if
+    // the sensor has never produced a reading.
+    void emitHealth(Stream& s) {
+      char buf[160];
+      uint32_t curMillis = millis();
+      s.print('{');
+      #if defined(HAS_AQI_SENSOR)
+        const SecondarySerial& serial = phApp->streamToSensor;
+        s.print("\"pms\":[");
+        for (uint8_t i = 0; i < SecondarySerial::NSensors; i++) {
+          SecondarySerial::Stats st = serial.stats(i);
+          uint32_t age = serial.frameAge(i, curMillis);
+          Writer out(buf, sizeof(buf));
+          if (i) out.print(',');
+          out.print("{\"fps\":").printFloat(serial.frameRate(i), 2);
+          out.print(",\"frames\":").printUInt(st.framesAccepted);
+          out.print(",\"checksum\":").printUInt(st.checksumErrors);
+          out.print(",\"sync\":").printUInt(st.syncErrors);
+          out.print(",\"resyncs\":").printUInt(st.resyncs);
+          out.print(",\"overflow\":").printUInt(st.overflowBytes);
+          out.print(",\"age\":");
+          if (age == UINT32_MAX) out.print("null"); else out.printUInt(age);
+          out.print(",\"drifting\":").print(serial.sensors.channel(i).drifting ? "true" : "false");
+          out.print('}');
+          s.write(out.c_str(), out.length());
+        }
+        s.print(']');
+      #endif
+      #if defined(HAS_WEATHER_SENSOR)
+        static const char* const Names[WeatherSampler::NDevices] = {"BME280", "DHT22", "DS18B20"};
+        const WeatherSampler& sampler = phApp->weatherSampler;
+        uint32_t sampled = sampler.latest().timestamp;
+        #if defined(HAS_AQI_SENSOR)
+          s.print(',');
+        #endif
+        s.print("\"weather\":{\"age\":");
+        if (sampled) s.print(curMillis - sampled); else s.print("null");
+        s.print(",\"sensors\":[");
+        bool first = true;
+        for (uint8_t d = 0; d < WeatherSampler::NDevices; d++) {
+          if (!WeatherSampler::has((WeatherSampler::Device)d)) continue;
+          const WeatherSampler::Health& h = sampler.health((WeatherSampler::Device)d);
+          Writer out(buf, sizeof(buf));
+          if (!first) out.print(',');
+          out.print("{\"name\":\"").print(Names[d]);
+          out.print("\",\"reads\":").printUInt(h.reads);
+          out.print(",\"failures\":").printUInt(h.failures);
+          out.print(",\"us\":").printUInt(h.lastMicros);
+          out.print(",\"maxUs\":").printUInt(h.maxMicros);
+          out.print('}');
+          s.write(out.c_str(), out.length());
+          first = false;
+        }
+        s.print("]}");
+      #endif
+      s.print('}');
+    }
   }
   // ----- END: PHWebUI::Internal
 
 
   // ----- BEGIN: PHWebUI::Mappers
+  // Every placeholder that may appear in one of our page templates has an
+  // entry in Entries. Templates resolve their keys to an index into Entries
+  // once, when they are compiled, so rendering never compares key strings.
   namespace Mappers {
-    bool hasAQI(const String& key, String& val) {
+    using ValueFn = void (*)(uint8_t arg, Writer& out);
+
+    struct Entry {
+      const char* key;
+      ValueFn value;
+      uint8_t arg;
+    };
+
+    enum AQISetting : uint8_t {
+      AQIColor, AQIGraph0, AQIGraph1, AQIGraph2, AQIGraph3, AQIGraph4, AQIMethod0, AQIMethod1 };
+    enum HasWeather : uint8_t { HasTemp, HasHumi };
+    enum WeatherSetting : uint8_t {
+      RawTemp, RawHumi, TempColor, HumiColor,
+      WeatherGraph0, WeatherGraph1, WeatherGraph2, WeatherGraph3, WeatherGraph4 };
+    // The arg of a calibration key is (channel << 1) | CalField
+    enum CalField : uint8_t { CalGain, CalOffset };
+    constexpr uint8_t cal(Calibration::Channel c, CalField f) { return (c << 1) | f; }
+    enum WeatherReading : uint8_t { Temp, Humi, Baro, RelP, HeatIndex, DewPoint, DewPointSpread, WTimestamp };
+    enum PHSetting : uint8_t {
+      Desc, AIOKey, AIOUser, AIOGroup, IBright, Lat, Lng, GMapsKey,
+      CityID, WeatherKey, Units, Voltage, EventsPort };
+
+    void printTemp(float t, Writer& out) {
+      if (isnan(t)) { out.print("N/A"); return; }
+      out.printFloat(Output::temp(t), 1).print(Output::tempUnits());
+    }
+
+    void printTempSpread(float t, Writer& out) {
+      if (isnan(t)) { out.print("N/A"); return; }
+      out.printFloat(Output::tempSpread(t), 1).print(Output::tempUnits());
+    }
+
+    void printHumi(float h, Writer& out) {
+      if (isnan(h)) { out.print("N/A"); return; }
+      out.printFloat(h, 1).print('%');
+    }
+
+    void printBaro(float b, Writer& out) {
+      if (isnan(b)) { out.print("N/A"); return; }
+      out.printFloat(Output::baro(b), 1).print(Output::baroUnits());
+    }
+
+    // Equivalent to WebThing::encodeAttr(), but without the temporary String
+    void printAttr(const String& s, Writer& out) {
+      for (const char* p = s.c_str(); *p; p++) {
+        switch (*p) {
+          case '&':  out.print("&amp;"); break;
+          case '"':  out.print("&quot;"); break;
+          case '\'': out.print("&#39;"); break;
+          case '<':  out.print("&lt;"); break;
+          case '>':  out.print("&gt;"); break;
+          default:   out.print(*p); break;
+        }
+      }
+    }
+
+    void hasAQI(uint8_t, Writer& out) {
       #if defined(HAS_AQI_SENSOR)
-        if (key == "HAS_AQI") { val = "true"; return true; }
+        out.print("true");
       #else
-        if (key == "HAS_AQI") { val = "false"; return true; }
+        out.print("false");
       #endif
-      return false;
     }
 
-    bool mapAQISettings(const String& key, String& val) {
+    void aqiSetting(uint8_t which, Writer& out) {
       #if defined(HAS_AQI_SENSOR)
-        char gr = key[2] - '0';  // GraphRange. Returns '\0' if no such index
-        if (key == "AQI_CLR")   val = phSettings->aqiSettings.chartColors.aqi;
-        else if (gr == phSettings->aqiSettings.graphRange && key.startsWith("AG")) val = "selected";
-        else return false;
-        return true;
+        if (which == AQIColor) out.print(phSettings->aqiSettings.chartColors.aqi);
+        else if (which >= AQIMethod0) {
+          if (which - AQIMethod0 == phSettings->aqiSettings.useNowCast) out.print("selected");
+        }
+        else if (which - AQIGraph0 == phSettings->aqiSettings.graphRange) out.print("selected");
       #else
-        (void)key; (void)val; // Avoid compiler warning
-        return false;
+        (void)which; (void)out; // Avoid compiler warning
       #endif
     }
 
-    bool mapAQIReadings(const String& key, String& val) {
+    void aqiReading(uint8_t field, Writer& out) {
       #if defined(HAS_AQI_SENSOR)
-        const AQIReadings& aqiReadings = phApp->aqiMgr.getLastReadings();
-        if (key == "AQI")      val.concat(phApp->aqiMgr.derivedAQI(aqiReadings.env.pm25));
-        else if (key == "PM10STD")  val.concat(aqiReadings.standard.pm10);
-        else if (key == "PM25STD")  val.concat(aqiReadings.standard.pm25);
-        else if (key == "PM100STD") val.concat(aqiReadings.standard.pm100);
-        else if (key == "PM10ENV")  val.concat(aqiReadings.env.pm10);
-        else if (key == "PM25ENV")  val.concat(aqiReadings.env.pm25);
-        else if (key == "PM100ENV") val.concat(aqiReadings.env.pm100);
-        else if (key == "P03")      val.concat(aqiReadings.particles_03um);
-        else if (key == "P05")      val.concat(aqiReadings.particles_05um);
-        else if (key == "P10")      val.concat(aqiReadings.particles_10um);
-        else if (key == "P25")      val.concat(aqiReadings.particles_25um);
-        else if (key == "P50")      val.concat(aqiReadings.particles_50um);
-        else if (key == "P100")     val.concat(aqiReadings.particles_100um);
-        else if (key == "TMST")     val = Output::formattedTime(Basics::wallClockFromMillis(aqiReadings.timestamp));
-        else return false;
-        return true;
+        out.print(phApp->aqiValues.value((AQIValueCache::Field)field));
       #else
-        (void)key; (void)val; // Avoid compiler warning
-        return false;
+        (void)field; (void)out; // Avoid compiler warning
       #endif
     }
 
-    bool hasWeather(const String& key, String& val) {
+    void hasWeather(uint8_t which, Writer& out) {
       #if defined(HAS_WEATHER_SENSOR)
-        if (key == "HAS_TEMP") {
-          val = (phApp->weatherMgr.hasTemp()) ? "true" : "false";
-          return true;
-        }
-        if (key == "HAS_HUMI") {
-          val = (phApp->weatherMgr.hasHumi()) ? "true" : "false";
-          return true;
-        }
+        bool has = (which == HasTemp) ? phApp->weatherMgr.hasTemp() : phApp->weatherMgr.hasHumi();
+        out.print(has ? "true" : "false");
       #else
-        if (key == "HAS_TEMP") { val = "false"; return true; }
-        if (key == "HAS_HUMI") { val = "false"; return true; }
+        (void)which;
+        out.print("false");
       #endif
-      return false;
     }
 
-
-#define TEMP_TO_STRING(t, s) {                                    \
-  if (isnan(wReadings.temp)) s = "N/A";                           \
-  else s = String(Output::temp(t), 1) + Output::tempUnits();      \
-}
-#define TEMP_SPREAD_TO_STRING(t, s) {                             \
-  if (isnan(wReadings.temp)) s = "N/A";                           \
-  else s = String(Output::tempSpread(t), 1) + Output::tempUnits();\
-}
-#define HUMI_TO_STRING(h, s) {                                    \
-  if (isnan(wReadings.humidity)) s = "N/A";                       \
-  else s = String(wReadings.humidity, 1) + '%';                   \
-}
-#define BARO_TO_STRING(b, s) {                                    \
-  if (isnan(wReadings.pressure)) s = "N/A";                       \
-  else s = String(Output::baro(b), 1) + Output::baroUnits();      \
-}
-
-
-    bool mapWeatherSettings(const String& key, String& val) {
-      char gr = key[2] - '0';  // GraphRange. Returns '\0' if no such index
+    void weatherSetting(uint8_t which, Writer& out) {
       #if defined(HAS_WEATHER_SENSOR)
-        const WeatherReadings& wReadings = phApp->weatherMgr.getLastReadings();
-        if (key == "TEMP_CORRECT") { 
-          float tempCorrection = wtApp->settings->uiOptions.useMetric ? 
-            phSettings->weatherSettings.tempCorrection :
-            Basics::delta_c_to_f(phSettings->weatherSettings.tempCorrection);
-            val.concat(tempCorrection);
+        const WeatherSampler::Sample& raw = phApp->weatherSampler.latest();
+        switch (which) {
+          case RawTemp: printTemp(raw.temp, out); break;
+          case RawHumi: printHumi(raw.humi, out); break;
+          case TempColor: out.print(phSettings->weatherSettings.chartColors.temp); break;
+          case HumiColor: out.print(phSettings->weatherSettings.chartColors.humi); break;
+          default:
+            if (which - WeatherGraph0 == phSettings->weatherSettings.graphRange) out.print("selected");
+            break;
         }
-        else if (key == "HUMI_CORRECT") val.concat(phSettings->weatherSettings.humiCorrection);
-        else if (key == "RAW_TEMP") {
-          float rawTemp = wReadings.temp - phSettings->weatherSettings.tempCorrection;
-          TEMP_TO_STRING(rawTemp, val);
-        }
-        else if (key == "RAW_HUMI") {
-          float rawHumi = wReadings.humidity - phSettings->weatherSettings.humiCorrection;
-          HUMI_TO_STRING(wReadings.humidity, val);
-        }
-        else if (key == "TEMP") { TEMP_TO_STRING(wReadings.temp, val); }
-        else if (key == "HUMI") { HUMI_TO_STRING(wReadings.humidity, val); }
-        else if (key == "TEMP_CLR")     val = phSettings->weatherSettings.chartColors.temp;
-        else if (key == "HUMI_CLR")     val = phSettings->weatherSettings.chartColors.humi;
-        else if (gr == phSettings->weatherSettings.graphRange && key.startsWith("WG")) val = "selected";
-        else return false;
-        return true;
       #else
-        (void)key; (void)val; // Avoid compiler warning
-        return false;
+        (void)which; (void)out; // Avoid compiler warning
       #endif
     }
 
-    bool mapWeatherReadings(const String& key, String& val) {
+    // Gains and offsets are shown as entered. Temperature offsets are stored
+    // in Celsius but shown in the user's units.
+    void calSetting(uint8_t which, Writer& out) {
+      const CalibrationSettings& settings = phSettings->calibration;
+      Calibration::Channel c = (Calibration::Channel)(which >> 1);
+      if ((which & 1) == CalGain) { out.printFloat(settings.gain[c], 3); return; }
+      float offset = settings.offset[c];
+      if (c == Calibration::Temp && !wtApp->settings->uiOptions.useMetric) {
+        offset = Basics::delta_c_to_f(offset);
+      }
+      out.printFloat(offset, 2);
+    }
+
+    #if defined(HAS_WEATHER_SENSOR)
+    // The formatted time of the last weather reading. It is only rebuilt
+    // when a new reading arrives.
+    const char* weatherTime(uint32_t timestamp) {
+      static uint32_t formattedFor = 0;
+      static char formatted[32] = "";
+      if (timestamp != formattedFor || formatted[0] == '\0') {
+        snprintf(formatted, sizeof(formatted), "%s",
+          Output::formattedTime(Basics::wallClockFromMillis(timestamp)).c_str());
+        formattedFor = timestamp;
+      }
+      return formatted;
+    }
+    #endif
+
+    void weatherReading(uint8_t which, Writer& out) {
       #if defined(HAS_WEATHER_SENSOR)
         const WeatherReadings& wReadings = phApp->weatherMgr.getLastReadings();
-        if (key == "TEMP")  { TEMP_TO_STRING(wReadings.temp, val); }
-        else if (key == "HUMI") { HUMI_TO_STRING(wReadings.humidity, val); }
-        else if (key == "BARO") { BARO_TO_STRING(wReadings.pressure, val); }
-        else if (key == "RELP") { BARO_TO_STRING(wReadings.relPressure, val); }
-        else if (key == "HTIN") { TEMP_TO_STRING(wReadings.heatIndex, val); }
-        else if (key == "DWPT") { TEMP_TO_STRING(wReadings.dewPointTemp, val); }
-        else if (key == "DPSP") { TEMP_SPREAD_TO_STRING(wReadings.dewPointSpread, val); }
-        else if (key == "W_TMST")
-          val = Output::formattedTime(Basics::wallClockFromMillis(wReadings.timestamp));
-        else return false;
-        return true;
+        switch (which) {
+          case Temp:      printTemp(wReadings.temp, out); break;
+          case Humi:      printHumi(wReadings.humidity, out); break;
+          case Baro:      printBaro(wReadings.pressure, out); break;
+          case RelP:      printBaro(wReadings.relPressure, out); break;
+          case HeatIndex: printTemp(wReadings.heatIndex, out); break;
+          case DewPoint:  printTemp(wReadings.dewPointTemp, out); break;
+          case DewPointSpread: printTempSpread(wReadings.dewPointSpread, out); break;
+          case WTimestamp: out.print(weatherTime(wReadings.timestamp)); break;
+        }
       #else
-        (void)key; (void)val; // Avoid compiler warning
-        return false;
+        (void)which; (void)out; // Avoid compiler warning
       #endif
     }
 
-    bool mapPHSettings(const String& key, String& val) {
-      if      (key == "DESC")       val = WebThing::encodeAttr(phSettings->description);
-      else if (key == "AIO_KEY")    val = phSettings->aio.key;
-      else if (key == "AIO_USER")   val = phSettings->aio.username;
-      else if (key == "AIO_GROUP")  val = phSettings->aio.groupName;
-      else if (key == "I_BRIGHT")   val.concat(phSettings->iBright);
-      else if (key == "LAT")        val = WebThing::settings.latAsString();
-      else if (key == "LNG")        val = WebThing::settings.lngAsString();
-      else if (key == "GMAPS_KEY")  val = WebThing::settings.googleMapsKey;
-      else if (key.equals(F("CITYID"))) {
-        if (wtApp->settings->owmOptions.enabled) val = wtApp->settings->owmOptions.cityID;
-        else val.concat("5380748");  // Palo Alto, CA, USA
+    void phSetting(uint8_t which, Writer& out) {
+      switch (which) {
+        case Desc:      printAttr(phSettings->description, out); break;
+        case AIOKey:    out.print(phSettings->aio.key); break;
+        case AIOUser:   out.print(phSettings->aio.username); break;
+        case AIOGroup:  out.print(phSettings->aio.groupName); break;
+        case IBright:   out.printUInt(phSettings->iBright); break;
+        case Lat:       out.printFloat(WebThing::settings.lat, 6); break;
+        case Lng:       out.printFloat(WebThing::settings.lng, 6); break;
+        case GMapsKey:  out.print(WebThing::settings.googleMapsKey); break;
+        case CityID:
+          if (wtApp->settings->owmOptions.enabled) out.print(wtApp->settings->owmOptions.cityID);
+          else out.print("5380748");  // Palo Alto, CA, USA
+          break;
+        case WeatherKey: out.print(wtApp->settings->owmOptions.key); break;
+        case Units:     out.print(wtApp->settings->uiOptions.useMetric ? "metric" : "imperial"); break;
+        case Voltage: {
+          float voltage = WebThing::measureVoltage();
+          if (voltage == -1) out.print("N/A");
+          else out.printFloat(voltage, 2).print('V');
+          break;
+        }
+        case EventsPort: out.printUInt(EventStream::DefaultPort); break;
       }
-      else if (key.equals(F("WEATHER_KEY"))) val = wtApp->settings->owmOptions.key;
-      else if (key.equals(F("UNITS"))) val = wtApp->settings->uiOptions.useMetric ? "metric" : "imperial";
-      else if (key == "VLTG") {
-        float voltage = WebThing::measureVoltage();
-        if (voltage == -1) val = "N/A";
-        else val = (String(voltage, 2) + "V");
+    }
+
+    constexpr Entry Entries[] = {
+      {"HAS_AQI",       hasAQI,         0},
+      {"AQI_CLR",       aqiSetting,     AQIColor},
+      {"AG0",           aqiSetting,     AQIGraph0},
+      {"AG1",           aqiSetting,     AQIGraph1},
+      {"AG2",           aqiSetting,     AQIGraph2},
+      {"AG3",           aqiSetting,     AQIGraph3},
+      {"AG4",           aqiSetting,     AQIGraph4},
+      {"AM0",           aqiSetting,     AQIMethod0},
+      {"AM1",           aqiSetting,     AQIMethod1},
+      {"AQI",           aqiReading,     AQIValueCache::AQI},
+      {"PM10STD",       aqiReading,     AQIValueCache::PM10Std},
+      {"PM25STD",       aqiReading,     AQIValueCache::PM25Std},
+      {"PM100STD",      aqiReading,     AQIValueCache::PM100Std},
+      {"PM10ENV",       aqiReading,     AQIValueCache::PM10Env},
+      {"PM25ENV",       aqiReading,     AQIValueCache::PM25Env},
+      {"PM100ENV",      aqiReading,     AQIValueCache::PM100Env},
+      {"P03",           aqiReading,     AQIValueCache::P03},
+      {"P05",           aqiReading,     AQIValueCache::P05},
+      {"P10",           aqiReading,     AQIValueCache::P10},
+      {"P25",           aqiReading,     AQIValueCache::P25},
+      {"P50",           aqiReading,     AQIValueCache::P50},
+      {"P100",          aqiReading,     AQIValueCache::P100},
+      {"NOWCAST",       aqiReading,     AQIValueCache::NowCastAQI},
+      {"TMST",          aqiReading,     AQIValueCache::Timestamp},
+      {"HAS_TEMP",      hasWeather,     HasTemp},
+      {"HAS_HUMI",      hasWeather,     HasHumi},
+      {"TEMP_GAIN",     calSetting,     cal(Calibration::Temp, CalGain)},
+      {"TEMP_CORRECT",  calSetting,     cal(Calibration::Temp, CalOffset)},
+      {"HUMI_GAIN",     calSetting,     cal(Calibration::Humi, CalGain)},
+      {"HUMI_CORRECT",  calSetting,     cal(Calibration::Humi, CalOffset)},
+      {"PRES_GAIN",     calSetting,     cal(Calibration::Pressure, CalGain)},
+      {"PRES_CORRECT",  calSetting,     cal(Calibration::Pressure, CalOffset)},
+      {"PM10_GAIN",     calSetting,     cal(Calibration::PM10, CalGain)},
+      {"PM10_CORRECT",  calSetting,     cal(Calibration::PM10, CalOffset)},
+      {"PM25_GAIN",     calSetting,     cal(Calibration::PM25, CalGain)},
+      {"PM25_CORRECT",  calSetting,     cal(Calibration::PM25, CalOffset)},
+      {"PM100_GAIN",    calSetting,     cal(Calibration::PM100, CalGain)},
+      {"PM100_CORRECT", calSetting,     cal(Calibration::PM100, CalOffset)},
+      {"RAW_TEMP",      weatherSetting, RawTemp},
+      {"RAW_HUMI",      weatherSetting, RawHumi},
+      {"TEMP_CLR",      weatherSetting, TempColor},
+      {"HUMI_CLR",      weatherSetting, HumiColor},
+      {"WG0",           weatherSetting, WeatherGraph0},
+      {"WG1",           weatherSetting, WeatherGraph1},
+      {"WG2",           weatherSetting, WeatherGraph2},
+      {"WG3",           weatherSetting, WeatherGraph3},
+      {"WG4",           weatherSetting, WeatherGraph4},
+      {"TEMP",          weatherReading, Temp},
+      {"HUMI",          weatherReading, Humi},
+      {"BARO",          weatherReading, Baro},
+      {"RELP",          weatherReading, RelP},
+      {"HTIN",          weatherReading, HeatIndex},
+      {"DWPT",          weatherReading, DewPoint},
+      {"DPSP",          weatherReading, DewPointSpread},
+      {"W_TMST",        weatherReading, WTimestamp},
+      {"DESC",          phSetting,      Desc},
+      {"AIO_KEY",       phSetting,      AIOKey},
+      {"AIO_USER",      phSetting,      AIOUser},
+      {"AIO_GROUP",     phSetting,      AIOGroup},
+      {"I_BRIGHT",      phSetting,      IBright},
+      {"LAT",           phSetting,      Lat},
+      {"LNG",           phSetting,      Lng},
+      {"GMAPS_KEY",     phSetting,      GMapsKey},
+      {"CITYID",        phSetting,      CityID},
+      {"WEATHER_KEY",   phSetting,      WeatherKey},
+      {"UNITS",         phSetting,      Units},
+      {"VLTG",          phSetting,      Voltage},
+      {"EVENTS_PORT",   phSetting,      EventsPort}
+    };
+    constexpr uint8_t NEntries = countof(Entries);
+    static_assert(NEntries < PageTemplate::NoValue, "Too many page keys");
+
+    // Used when a template is compiled. Keys we don't know about render as
+    // an empty string, just as they did with ESPTemplateProcessor.
+    uint8_t resolve(const char* key) {
+      for (uint8_t i = 0; i < NEntries; i++) {
+        if (strcmp(Entries[i].key, key) == 0) return i;
       }
-      else return false;
-      return true;
+      Log.verbose(F("PHWebUI::Mappers::resolve: no mapping for %s"), key);
+      return PageTemplate::NoValue;
+    }
+
+    // Used when a template is rendered
+    void value(uint8_t id, Writer& out) {
+      const Entry& e = Entries[id];
+      e.value(e.arg, out);
     }
   }
   // ----- END: PHWebUI::Mappers
 
 
-  // ----- BEGIN: PHWebUI::Endpoints
+  // ----- BEGIN: PHWebUI::Events
+  // Pushes the live readings to pages (such as the home page) that are
+  // listening on the EventStream. Each record is a JSON object that maps
+  // template keys to the same values that the templates would show.
+  namespace Events {
+    EventStream stream;
+
+    const char* LiveKeys[] = {
+#if defined(HAS_AQI_SENSOR)
+      "AQI", "TMST",
+      "PM10STD", "PM25STD", "PM100STD", "PM10ENV", "PM25ENV", "PM100ENV",
+      "P03", "P05", "P10", "P25", "P50", "P100", "NOWCAST",
+#endif
+#if defined(HAS_WEATHER_SENSOR)
+      "TEMP", "HUMI", "BARO", "RELP", "HTIN", "DWPT", "DPSP", "W_TMST",
+#endif
+    };
+    constexpr uint8_t NLiveKeys = countof(LiveKeys);
+    uint8_t liveIds[NLiveKeys];
+
+    void begin() {
+      for (uint8_t i = 0; i < NLiveKeys; i++) liveIds[i] = Mappers::resolve(LiveKeys[i]);
+      stream.begin();
+    }
+
+    void publishReadings() {
+      static char record[EventStream::MaxMessageSize];
+      Writer out(record, sizeof(record));
+      out.print('{');
+      for (uint8_t i = 0; i < NLiveKeys; i++) {
+        if (i) out.print(',');
+        out.print('"').print(LiveKeys[i]).print("\":\"");
+        Mappers::value(liveIds[i], out);
+        out.print('"');
+      }
+      out.print('}');
+      stream.publish("readings", record);
+    }
+  }
+  // ----- END: PHWebUI::Events
+
+
+  // ----- BEGIN: PHWebUI::Pages
   namespace Pages {
+    PageTemplate homePage;
+    PageTemplate chartPage;
+    PageTemplate configPage;
+
+    void compileTemplates() {
+      homePage.compile("/HomePage.html", Mappers::resolve);
+      chartPage.compile("/ChartPage.html", Mappers::resolve);
+      configPage.compile("/ConfigForm.html", Mappers::resolve);
+    }
+
+    // Wraps a precompiled template with the standard page header and footer
+    void sendPage(const char* pageName, PageTemplate& page) {
+      auto action = [&page]() {
+        WebUI::startPage();
+        page.render(Mappers::value);
+        WebUI::finishPage();
+      };
+
+      WebUI::wrapWebAction(pageName, action, true);
+    }
 
     // Displays the home page which shows the last set of weather readings.
     //
@@ -226,27 +717,11 @@ namespace PHWebUI {
     //    GET  /displayHomePage
     //
     void displayHomePage() {
-      auto mapper =[](const String &key, String& val) -> void {
-        if (Mappers::mapPHSettings(key, val)) return;
-        if (Mappers::hasWeather(key, val)) return;
-        if (Mappers::hasAQI(key, val)) return;
-        if (Mappers::mapWeatherReadings(key, val)) return;
-        if (Mappers::mapAQIReadings(key, val)) return;
-      };
-
-      WebUI::wrapWebPage("/", "/HomePage.html", mapper);
+      sendPage("/", homePage);
     }
 
     void displayChartPage() {
-      auto mapper =[](const String &key, String& val) -> void {
-        if (Mappers::hasAQI(key, val)) return;
-        if (Mappers::hasWeather(key, val)) return;
-        if (Mappers::mapAQISettings(key, val)) return;
-        if (Mappers::mapWeatherSettings(key, val)) return;
-        if (Mappers::mapPHSettings(key, val)) return;
-      };
-
-      WebUI::wrapWebPage("/displayChartPage", "/ChartPage.html", mapper);
+      sendPage("/displayChartPage", chartPage);
     }
 
     // Displays a form allowing the user to update the PurpleHaze settings.
@@ -255,25 +730,32 @@ namespace PHWebUI {
     //    GET  /displayPHConfig
     //
     void displayPHConfig() {
-      auto mapper =[&](const String &key, String& val) -> void {
-        if (Mappers::hasAQI(key, val)) return;
-        if (Mappers::hasWeather(key, val)) return;
-        if (Mappers::mapAQISettings(key, val)) return;
-        if (Mappers::mapWeatherSettings(key, val)) return;
-        if (Mappers::mapPHSettings(key, val)) return;
-      };
-
-      WebUI::wrapWebPage("/displayPHConfig", "/ConfigForm.html", mapper);
+      sendPage("/displayPHConfig", configPage);
     }
   }   // ----- END: PHWebUI::Pages
 
 
   namespace Endpoints {
 #if defined(HAS_AQI_SENSOR)
+    // Returns the AQI history as JSON. If since is supplied, only the samples
+    // in the given range that are newer than since are returned. If format
+    // is bin, the samples are returned in the form described at
+    // Internal::emitSamplesBin(). The month and year ranges are always served
+    // from the app's history.
+    //
+    // If start is supplied instead of a range, the samples from start to end
+    // (default: the newest) are returned from the finest range of the app's
+    // history that reaches back to start. If points is supplied, at most that
+    // many are returned, chosen on AQI by src/history/Downsampler.
+    //
+    // Form:
+    //    GET /getHistory?range=[hour|day|week|month|year]&since=TIMESTAMP&format=[json|bin]
+    //    GET /getHistory?start=TIMESTAMP&end=TIMESTAMP&points=N&format=[json|bin]
+    //
     void getHistory() {
       auto action = []() {
         String rangeArg = WebUI::arg("range");
-        AQIMgr::HistoryRange range;
+        AQIMgr::HistoryRange range = AQIMgr::HistoryRange::Range_1Hour;
         bool combined = false;
 
         if (rangeArg.equalsIgnoreCase("hour")) range = AQIMgr::HistoryRange::Range_1Hour;
@@ -281,12 +763,29 @@ namespace PHWebUI {
         else if (rangeArg.equalsIgnoreCase("week")) range = AQIMgr::HistoryRange::Range_1Week;
         else combined = true;
 
+        History::Range appRange = History::Hour;
+        uint32_t since = 0;
+        bool binary = false;
+        bool fromApp = Internal::appHistoryRequest(appRange, since, binary);
+        Internal::HistoryWindow window = {};
+        bool windowed = Internal::windowRequest(window);
+        binary = binary && (fromApp || windowed);
+
         auto provider = [=](Stream& s) -> void {
-          if (combined) phApp->aqiMgr.emitHistoryAsJson(s);
+          if (windowed && binary) Internal::emitWindowBin(
+            window, Internal::aqiValue, Internal::AQIField, s);
+          else if (windowed) {
+            Downsampler samples = Internal::windowSamples(window, Internal::aqiValue);
+            Internal::emitAQISamples(samples, s);
+          }
+          else if (binary) Internal::emitHistoryBin(appRange, since, Internal::AQIField, s);
+          else if (fromApp) Internal::emitAQIHistory(appRange, since, s);
+          else if (combined) phApp->aqiMgr.emitHistoryAsJson(s);
           else phApp->aqiMgr.emitHistoryAsJson(range, s);
         };
 
-        WebUI::sendArbitraryContent("application/json", -1, provider);
+        WebUI::sendArbitraryContent(
+          binary ? "application/octet-stream" : "application/json", -1, provider);
       };
 
       WebUI::wrapWebAction("/getHistory", action, false);
@@ -296,10 +795,23 @@ namespace PHWebUI {
 #endif
 
 #if defined(HAS_WEATHER_SENSOR)
+    // Returns the weather history as JSON. If since is supplied, only the
+    // samples in the given range that are newer than since are returned. If
+    // format is bin, the samples are returned in the form described at
+    // Internal::emitSamplesBin(). The month and year ranges are always served
+    // from the app's history.
+    //
+    // A window of time may be requested with start, end, and points as for
+    // /getHistory. Samples are chosen on temperature.
+    //
+    // Form:
+    //    GET /getWeatherHistory?range=[hour|day|week|month|year]&since=TIMESTAMP&format=[json|bin]
+    //    GET /getWeatherHistory?start=TIMESTAMP&end=TIMESTAMP&points=N&format=[json|bin]
+    //
     void getWeatherHistory() {
       auto action = []() {
         String rangeArg = WebUI::arg("range");
-        WeatherMgr::HistoryRange range;
+        WeatherMgr::HistoryRange range = WeatherMgr::HistoryRange::Range_1Hour;
         bool combined = false;
 
         if (rangeArg.equalsIgnoreCase("hour")) range = WeatherMgr::HistoryRange::Range_1Hour;
@@ -307,12 +819,30 @@ namespace PHWebUI {
         else if (rangeArg.equalsIgnoreCase("week")) range = WeatherMgr::HistoryRange::Range_1Week;
         else combined = true;
 
+        History::Range appRange = History::Hour;
+        uint32_t since = 0;
+        bool binary = false;
+        bool fromApp = Internal::appHistoryRequest(appRange, since, binary);
+        Internal::HistoryWindow window = {};
+        bool windowed = Internal::windowRequest(window);
+        binary = binary && (fromApp || windowed);
+
         auto provider = [=](Stream& s) -> void {
-          if (combined) phApp->weatherMgr.emitHistoryAsJson(s);
+          if (windowed && binary) Internal::emitWindowBin(
+            window, Internal::tempValue, Internal::TempField|Internal::HumiField, s);
+          else if (windowed) {
+            Downsampler samples = Internal::windowSamples(window, Internal::tempValue);
+            Internal::emitWeatherSamples(samples, s);
+          }
+          else if (binary) Internal::emitHistoryBin(
+            appRange, since, Internal::TempField|Internal::HumiField, s);
+          else if (fromApp) Internal::emitWeatherHistory(appRange, since, s);
+          else if (combined) phApp->weatherMgr.emitHistoryAsJson(s);
           else phApp->weatherMgr.emitHistoryAsJson(range, s);
         };
 
-        WebUI::sendArbitraryContent("application/json", -1, provider);
+        WebUI::sendArbitraryContent(
+          binary ? "application/octet-stream" : "application/json", -1, provider);
       };
 
       WebUI::wrapWebAction("/getWeatherHistory", action, false);
@@ -321,15 +851,67 @@ namespace PHWebUI {
     void getWeatherHistory() { WebUI::redirectHome(); }
 #endif
 
+    // Returns the AQI and weather history for every range in a single binary
+    // response. Within a range, AQI and weather values for the same period
+    // share one timestamp. The form is:
+    //    varint  the fields included (see Internal::HistoryField)
+    //    The hour, day, week, month, and year ranges, in that order, each in
+    //    the form described at Internal::emitSamplesBin()
+    // If supplied, since holds a timestamp for each range and only newer
+    // samples are returned.
+    //
+    // Form:
+    //    GET /getAllHistory?since=HOUR_TS,DAY_TS,WEEK_TS,MONTH_TS,YEAR_TS
+    //
+    void getAllHistory() {
+      auto action = []() {
+        uint32_t since[History::NRanges] = {0};
+        String sinceArg = WebUI::arg("since");
+        const char* p = sinceArg.c_str();
+        for (int r = 0; r < History::NRanges && *p; r++) {
+          char* end;
+          since[r] = strtoul(p, &end, 10);
+          p = (*end == ',') ? end + 1 : end;
+        }
+
+        auto provider = [=](Stream& s) -> void {
+          uint8_t fields = Internal::availableFields();
+          Internal::BinWriter out(s);
+          out.put(fields);
+          for (int r = 0; r < History::NRanges; r++) {
+            Internal::emitRangeBin((History::Range)r, since[r], fields, out);
+          }
+        };
+
+        WebUI::sendArbitraryContent("application/octet-stream", -1, provider);
+      };
+
+      WebUI::wrapWebAction("/getAllHistory", action, false);
+    }
+
+    // Returns the health counters of the sensors as JSON. See
+    // Internal::emitHealth().
+    //
+    // Form:
+    //    GET /getHealth
+    //
+    void getHealth() {
+      auto action = []() {
+        auto provider = [](Stream& s) -> void { Internal::emitHealth(s); };
+        WebUI::sendArbitraryContent("application/json", -1, provider);
+      };
+
+      WebUI::wrapWebAction("/getHealth", action, false);
+    }
+
 #if defined(HAS_AQI_SENSOR)
     void getAQI() {
       auto action = []() {
         String result;
         result.reserve(300);
-        const AQIReadings& aqiReadings = phApp->aqiMgr.getLastReadings();
         phApp->aqiMgr.aqiAsJSON(
-          phApp->aqiMgr.derivedAQI(aqiReadings.env.pm25),
-          aqiReadings.timestamp, result);
+          phApp->aqiValues.derived().aqi,
+          phApp->aqiMgr.getLastReadings().timestamp, result);
         WebUI::sendStringContent("application/json", result);
       };
 
@@ -339,6 +921,24 @@ namespace PHWebUI {
     void getAQI() { WebUI::redirectHome(); }
 #endif
 
+    // Reads the gain and offset for channel c from the form args NAMEGain and
+    // NAMECorrection, where NAME is the channel's name. Channels whose args
+    // weren't submitted are left alone.
+    void updateCalibration(Calibration::Channel c) {
+      String name(Calibration::name(c));
+      String gainArg = WebUI::arg(name + "Gain");
+      String offsetArg = WebUI::arg(name + "Correction");
+      CalibrationSettings& settings = phSettings->calibration;
+      if (!gainArg.isEmpty()) settings.gain[c] = gainArg.toFloat();
+      if (!offsetArg.isEmpty()) {
+        float offset = offsetArg.toFloat();
+        if (c == Calibration::Temp && !wtApp->settings->uiOptions.useMetric) {
+          offset = Basics::delta_f_to_c(offset);
+        }
+        settings.offset[c] = offset;
+      }
+    }
+
     // Handler for the "/updatePHConfig" endpoint. This is invoked as the target
     // of the form presented by "/displayPHConfig". It updates the values of the
     // corresponding settings and writes the settings to EEPROM.
@@ -359,22 +959,20 @@ namespace PHWebUI {
 #if defined(HAS_AQI_SENSOR)
         phSettings->aqiSettings.chartColors.aqi = WebUI::arg("aqiColor");
         phSettings->aqiSettings.graphRange = WebUI::arg("aqiGraphRange").toInt();
-        phApp->appScreens.aqiGraphScreen->selectBuffer(phSettings->aqiSettings.graphRange);
+        phApp->appScreens.aqiGraphScreen->selectRange(phSettings->aqiSettings.graphRange);
+        phSettings->aqiSettings.useNowCast = WebUI::arg("aqiMethod").toInt() == 1;
+        phApp->aqiValues.setUseNowCast(phSettings->aqiSettings.useNowCast);
 #endif
 #if defined(HAS_WEATHER_SENSOR)
-        float tempCorrection = WebUI::arg("tempCorrection").toFloat();
-        phSettings->weatherSettings.tempCorrection = wtApp->settings->uiOptions.useMetric ?
-            tempCorrection : Basics::delta_f_to_c(tempCorrection);
-        phSettings->weatherSettings.humiCorrection = WebUI::arg("humiCorrection").toFloat();
         phSettings->weatherSettings.chartColors.temp = WebUI::arg("tempColor");
         phSettings->weatherSettings.chartColors.humi = WebUI::arg("humiColor");
         phSettings->weatherSettings.graphRange = WebUI::arg("weatherGraphRange").toInt();
-        phApp->appScreens.weatherGraphScreen->selectBuffer(phSettings->weatherSettings.graphRange);
-        phApp->weatherMgr.setAttributes(
-          phSettings->weatherSettings.tempCorrection,
-          phSettings->weatherSettings.humiCorrection,
-          WebThing::settings.elevation);
+        phApp->appScreens.weatherGraphScreen->selectRange(phSettings->weatherSettings.graphRange);
 #endif
+        for (uint8_t c = 0; c < Calibration::NChannels; c++) {
+          updateCalibration((Calibration::Channel)c);
+        }
+        phSettings->calibration.applyTo(phApp->calibration);
         phSettings->write();
 
         phApp->setIndicatorBrightness(phSettings->iBright);
@@ -392,6 +990,7 @@ namespace PHWebUI {
 
   void init() {
     WebUIHelper::init(Internal::APP_MENU_ITEMS);
+    Pages::compileTemplates();
 
 #if defined(HAS_AQI_SENSOR)
     WebUI::Dev::addButton({"View AQI History", "getHistory", nullptr, nullptr});
@@ -399,6 +998,9 @@ namespace PHWebUI {
 #if defined(HAS_WEATHER_SENSOR)
       WebUI::Dev::addButton({"View Weather History", "getWeatherHistory", nullptr, nullptr});
 #endif
+    WebUI::Dev::addButton({"View Sensor Health", "getHealth", nullptr, nullptr});
+
+    Events::begin();
 
     WebUI::registerBusyCallback(Internal::showBusyStatus);
       // We override the default since we want to update the indicator icon in
@@ -411,13 +1013,23 @@ namespace PHWebUI {
     WebUI::registerHandler("/updatePHConfig",     Endpoints::updatePHConfig);
     WebUI::registerHandler("/getHistory",         Endpoints::getHistory);
     WebUI::registerHandler("/getWeatherHistory",  Endpoints::getWeatherHistory);
+    WebUI::registerHandler("/getAllHistory",      Endpoints::getAllHistory);
     WebUI::registerHandler("/getAQI",             Endpoints::getAQI);
+    WebUI::registerHandler("/getHealth",          Endpoints::getHealth);
 
     if (phSettings->description.length() != 0) {
       WebUI::setTitle(phSettings->description+" ("+WebThing::settings.hostname+")");
     }
   }
 
+  void loop() {
+    Events::stream.loop();
+  }
+
+  void readingsChanged() {
+    Events::publishReadings();
+  }
+
 
 }
 // ----- END: PHWebUI
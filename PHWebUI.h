@@ -12,6 +12,10 @@
 namespace PHWebUI {
   // ----- Setup functions
   void init();
+
+  // ----- Runtime functions
+  void loop();              // Call from the app's loop
+  void readingsChanged();   // Call when the AQI or weather readings change
 }
 
 #endif  // PHWebUI_h
\ No newline at end of file
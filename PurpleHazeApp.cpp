@@ -23,7 +23,6 @@
 #include <DataBroker.h>
 #include <WebUI.h>
 #include <clients/AIOMgr.h>
-#include <sensors/WeatherUtils.h>
 #include <clients/AIO_DevReadingsPublisher.h>
 #include <clients/AIO_WeatherPublisher.h>
 #include <clients/AIO_AQIPublisher.h>
@@ -137,8 +136,16 @@ void PurpleHazeApp::app_loop() {
   // periodic basis, so no need to do that here.
 
 #if defined(HAS_AQI_SENSOR)
+  streamToSensor.loop();  // Parse whatever has arrived so aqiMgr sees the latest frame
   aqiMgr.loop();
+  aqiValues.refresh();  // Formats the values only if a new frame arrived or the NowCast changed
 #endif
+#if defined(HAS_WEATHER_SENSOR)
+  weatherSampler.loop();  // One short step; weatherMgr reads the latest sample
+#endif
+
+  processNewReadings();
+  PHWebUI::loop();
 
 }
 
@@ -160,8 +167,7 @@ void PurpleHazeApp::app_conditionalUpdate(bool force) {
     const AQIReadings& aqiReadings = aqiMgr.getLastReadings();
     if (aqiReadings.timestamp != lastTimestamp) {
       busyIndicator->setColor(0, 255, 0);
-      uint16_t quality = aqiMgr.derivedAQI(aqiReadings.env.pm25);
-      qualityIndicator->setColor(aqiMgr.colorForQuality(quality));
+      qualityIndicator->setColor(aqiValues.derived().color);
       lastTimestamp = aqiReadings.timestamp;
       busyIndicator->off();
     }
@@ -173,7 +179,7 @@ void PurpleHazeApp::app_conditionalUpdate(bool force) {
 
   devReadingsMgr.takeReadings(force);
 
-  if (!startingUp) AIOMgr::publish();
+  if (!startingUp && shouldPublish()) AIOMgr::publish();
   startingUp = false;
 }
 
@@ -210,6 +216,7 @@ void PurpleHazeApp::app_configureHW() {
   configurePins();
   configureIndicators();
   prepSensors();
+  restoreState();
   
   // Technically this should be done later, since ScreenMgr.init() hasn't been
   // called yet.
@@ -235,10 +242,157 @@ void PurpleHazeApp::configModeCallback(const String &ssid, const String &ip) {
  *----------------------------------------------------------------------------*/
 
 void PurpleHazeApp::aboutToSleep() {
+  saveSleepState();
   AIOMgr::publish();
   Display.setBrightness(0);
 }
 
+// Feeds new AQI and weather readings into the app's history and pushes
+// them to any pages that are listening for live updates
+void PurpleHazeApp::processNewReadings() {
+  bool changed = false;
+
+  #if defined(HAS_AQI_SENSOR)
+    static uint32_t lastAQITimestamp = 0;
+    const AQIReadings& aqiReadings = aqiMgr.getLastReadings();
+    if (aqiReadings.timestamp != lastAQITimestamp) {
+      // A reading carried across deep sleep is shown, but it was recorded
+      // before the device went to sleep
+      const DerivedAQI& derived = aqiValues.derived();
+      if (restoredReading) restoredReading = false;
+      else history.addAQI(
+        Basics::wallClockFromMillis(aqiReadings.timestamp),
+        derived.instantAQI,
+        derived.nowCastAQI == DerivedAQI::NoAQI ? History::NoAQI : derived.nowCastAQI);
+      lastAQITimestamp = aqiReadings.timestamp;
+      changed = true;
+    }
+  #endif
+
+  #if defined(HAS_WEATHER_SENSOR)
+    static uint32_t lastWeatherTimestamp = 0;
+    const WeatherReadings& wReadings = weatherMgr.getLastReadings();
+    if (wReadings.timestamp != lastWeatherTimestamp) {
+      history.addWeather(
+        Basics::wallClockFromMillis(wReadings.timestamp),
+        wReadings.temp, wReadings.humidity, wReadings.pressure);
+      lastWeatherTimestamp = wReadings.timestamp;
+      changed = true;
+    }
+  #endif
+
+  history.loop(now());
+  historyLog.loop(history);
+  #if defined(HAS_AQI_SENSOR)
+    feedNowCast();
+    nowCast.loop(now());
+  #endif
+  if (changed) PHWebUI::readingsChanged();
+}
+
+// The NowCast is fed the PM2.5 of each closed sample of the history's hour
+// range, one minute's worth at weight 1. It is rebuilt after a restart from
+// the same samples in the log, so hours averaged before and after a
+// restart are made of the same statistic at the same weight.
+void PurpleHazeApp::feedNowCast() {
+  History::Sample s;
+  if (!history.newest(History::Hour, s) || s.ts <= nowCastFed) return;
+
+  History::Cursor c = history.samplesAfter(History::Hour, nowCastFed);
+  while (c.next(s)) {
+    if (s.pm25 != History::NoPM) nowCast.add(s.ts, (s.pm25 + 5) / 10);
+    nowCastFed = s.ts;
+  }
+}
+
+// Rebuilds the history, and the NowCast that depends on it, from the copy
+// kept in flash. After deep sleep, the state kept by saveSleepState() then
+// brings everything back to where it was when the device went to sleep.
+void PurpleHazeApp::restoreState() {
+  historyLog.begin();
+  historyLog.loadRollups(history);
+  historyLog.restore([this](const History::Sample& s) {
+    history.restore(s);
+    #if defined(HAS_AQI_SENSOR)
+      if (s.pm25 != History::NoPM) nowCast.add(s.ts, (s.pm25 + 5) / 10);
+    #endif
+    nowCastFed = s.ts;
+  });
+
+  SleepState state;
+  if (!state.take()) return;
+  const SleepState::Block& b = state.block;
+  // The NowCast saw these samples before the device went to sleep
+  historyLog.adopt(b.tail, b.nTail, [this](const History::Sample& s) {
+    history.restore(s);
+    nowCastFed = s.ts;
+  });
+  history.resume(b.history);
+
+  #if defined(HAS_AQI_SENSOR)
+    nowCast.resume(b.nowCast);
+    cadence.resume(b.interval);
+    aqiAggregator.setInterval(cadence.interval());
+    streamToSensor.setSampleInterval(cadence.interval());
+    if ((b.flags & SleepState::HasAQI) && streamToSensor.s) {
+      AQIReadings r = {};
+      for (uint8_t f = 0; f < PMS5003Parser::NFields; f++) PMS5003Parser::setField(r, f, b.aqi[f]);
+      streamToSensor.present(r);
+      restoredReading = true;
+    }
+  #endif
+  Log.trace(F("PurpleHazeApp::restoreState: Resumed from deep sleep"));
+}
+
+// Keeps what would take minutes to rebuild in RTC memory, where it survives
+// deep sleep. History records that haven't been written to flash go with
+// it, unless there are too many to fit.
+void PurpleHazeApp::saveSleepState() {
+  history.loop(now());
+  historyLog.loop(history);
+  #if defined(HAS_AQI_SENSOR)
+    feedNowCast();
+  #endif
+
+  SleepState state;
+  SleepState::Block& b = state.block;
+  memset(&b, 0, sizeof(b));
+
+  const HistoryLog::Record* unwritten;
+  uint8_t n = historyLog.unwritten(unwritten);
+  if (n > SleepState::TailRecords) { historyLog.flush(); n = 0; }
+  memcpy(b.tail, unwritten, n * sizeof(HistoryLog::Record));
+  b.nTail = n;
+  history.progress(b.history);
+
+  #if defined(HAS_AQI_SENSOR)
+    nowCast.save(b.nowCast);
+    b.interval = cadence.interval();
+    const AQIReadings& r = aqiMgr.getLastReadings();
+    if (r.timestamp) {
+      for (uint8_t f = 0; f < PMS5003Parser::NFields; f++) b.aqi[f] = PMS5003Parser::field(r, f);
+      b.flags |= SleepState::HasAQI;
+    }
+  #endif
+  state.save();
+}
+
+bool PurpleHazeApp::shouldPublish() {
+  // While the air is clean and steady the cadence stretches beyond its
+  // default and there is little point spending AIO quota on unchanged
+  // values, so publishing is spaced out to match. Otherwise AIOMgr's own
+  // schedule applies.
+  #if defined(HAS_AQI_SENSOR)
+    static uint32_t lastPublish = 0;
+    uint32_t interval = cadence.interval();
+    uint32_t curMillis = millis();
+    if (interval > AdaptiveCadence::DefaultInterval &&
+        lastPublish != 0 && curMillis - lastPublish < interval) return false;
+    lastPublish = curMillis;
+  #endif
+  return true;
+}
+
 void PurpleHazeApp::prepAIO() {
   if (phSettings->aio.username.isEmpty() || phSettings->aio.key.isEmpty()) {
     Log.trace("PurpleHazeApp::prepAIO: AIO username or key is empty");
@@ -272,9 +426,51 @@ void PurpleHazeApp::prepAIO() {
 // ----- Hardware Configuration
 //
 
+static_assert(PMHumidityJoin::NoValue == History::NoPM, "History stores missing corrections as NoPM");
+
 void PurpleHazeApp::prepSensors() {
+  phSettings->calibration.applyTo(calibration);
+
   #if defined(HAS_AQI_SENSOR)
     streamToSensor.begin();
+
+    // A closed interval's summary feeds history and AQIMgr
+    auto useSummary = [this]() {
+      const FrameAggregator::Summary& s = aqiAggregator.summary();
+      uint32_t ts = Basics::wallClockFromMillis(s.mean.timestamp);
+      uint32_t pm25 = s.median.env.pm25 * 10L;
+      history.addPM25(
+        ts, pm25 < History::NoPM ? pm25 : History::NoPM - 1, pmHumidity.correct(s.median));
+      streamToSensor.present(s.median);
+    };
+
+    streamToSensor.setFrameHandler([this, useSummary](const AQIReadings& raw) {
+      AQIReadings r = raw;
+      calibration.apply(r);
+
+      // r is the calibrated average of all of the sensors. AQIMgr sees one robust
+      // (median) reading per interval, and the interval length follows the
+      // cadence: 1 Hz while PM2.5 is moving, minutes while it is clean and
+      // steady. Long intervals also put the sensor to sleep between
+      // samples. Until the first interval closes, frames are passed through
+      // so there is something to show right after boot. History keeps the
+      // interval's PM2.5, as measured and corrected for the humidity at the
+      // time, and the NowCast is fed from history (see feedNowCast()).
+      cadence.observe(r.timestamp, r.env.pm25);
+      aqiAggregator.setInterval(cadence.interval());
+      streamToSensor.setSampleInterval(cadence.interval());
+      if (aqiAggregator.add(r)) useSummary();
+      else if (!aqiAggregator.hasSummary()) streamToSensor.present(r);
+    });
+
+    // A sleeping sensor's sample is complete once it has been taken. Close
+    // the interval then, rather than when the next sample's first frame
+    // arrives a whole cycle later.
+    streamToSensor.setSampleEndHandler([this, useSummary]() {
+      if (aqiAggregator.close()) useSummary();
+    });
+    aqiValues.begin(&aqiMgr, &nowCast);
+    aqiValues.setUseNowCast(phSettings->aqiSettings.useNowCast);
     if (!aqiMgr.init(streamToSensor.s, sensorIndicator)) {
       Log.error("Unable to connect to Air Quality Sensor!");
       qualityIndicator->setColor(255, 0, 0);
@@ -289,12 +485,13 @@ void PurpleHazeApp::prepSensors() {
       else busyIndicator->off();
     };
 
-    WeatherUtils::configureAvailableSensors(weatherMgr);
-    weatherMgr.init(
-      phSettings->weatherSettings.tempCorrection,
-      phSettings->weatherSettings.humiCorrection,
-      WebThing::settings.elevation,
-      weatherBusyCallBack);
+    // Corrections are applied by the sampler's calibration, not WeatherMgr
+    weatherSampler.setCalibration(&calibration);
+    weatherSampler.begin(weatherMgr);
+    weatherMgr.init(0.0, 0.0, WebThing::settings.elevation, weatherBusyCallBack);
+    #if defined(HAS_AQI_SENSOR)
+      pmHumidity.begin(&weatherSampler, &calibration);
+    #endif
   #endif
 }
 
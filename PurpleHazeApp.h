@@ -35,6 +35,16 @@
 #include "PHSettings.h"
 #include "PHScreenConfig.h"
 #include "src/hardware/SecondarySerial.h"
+#include "src/hardware/WeatherSampler.h"
+#include "src/data/AdaptiveCadence.h"
+#include "src/data/AQIValueCache.h"
+#include "src/data/Calibration.h"
+#include "src/data/NowCast.h"
+#include "src/data/PMHumidityJoin.h"
+#include "src/data/SleepState.h"
+#include "src/history/History.h"
+#include "src/history/HistoryLog.h"
+#include "src/sensors/FrameAggregator.h"
 //--------------- End:    Includes ---------------------------------------------
 
 
@@ -52,7 +62,19 @@ public:
   // CUSTOM: Data defined by this app which is available to the whole app
   AQIMgr aqiMgr;
   WeatherMgr weatherMgr;
+  WeatherSampler weatherSampler;  // Feeds weatherMgr without blocking the loop
   DevReadingsMgr devReadingsMgr;
+  AQIValueCache aqiValues;      // Formatted versions of the latest AQI readings
+  History history;              // Hour to year history of AQI and weather readings
+  HistoryLog historyLog;        // Keeps history in flash across restarts
+  SecondarySerial streamToSensor;
+  FrameAggregator aqiAggregator;  // Per-interval summaries of the raw sensor frames
+  AdaptiveCadence cadence;      // Interval length, driven by how volatile PM2.5 is
+  Calibration calibration;      // Corrections applied to readings as they are taken
+  NowCast nowCast;              // 12 hour weighted PM2.5 average, as used by AirNow
+  PMHumidityJoin pmHumidity;    // Humidity-corrected PM2.5
+  bool restoredReading = false; // The latest AQI reading was carried across deep sleep
+  uint32_t nowCastFed = 0;      // ts of the newest hour sample the NowCast has seen
 
   Indicator* sensorIndicator;
   Indicator* qualityIndicator;
@@ -85,13 +107,15 @@ private:
 
   void prepAIO();
   void prepSensors();
+  void restoreState();
+  void saveSleepState();
   void configureDisplay();
   void configurePins();
   void configureIndicators();
   void aboutToSleep();
-
-
-  SecondarySerial streamToSensor;
+  void processNewReadings();
+  void feedNowCast();
+  bool shouldPublish();
 };
 
 #endif	// PurpleHazeApp_h
@@ -0,0 +1,73 @@
+/*
+ * AQIValueCache
+ *    Holds pre-formatted versions of the most recent AQI readings
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+#include <Output.h>
+//                                  Local Includes
+#include "AQIValueCache.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+bool AQIValueCache::refresh() {
+  if (!aqiMgr) return false;
+  const AQIReadings& r = aqiMgr->getLastReadings();
+  if (isCurrent(r)) return false;
+  fill(r);
+  return true;
+}
+
+const char* AQIValueCache::value(Field f) {
+  lookup();
+  return (f == Timestamp) ? time : values[f];
+}
+
+const DerivedAQI& AQIValueCache::derived() {
+  lookup();
+  return _derived;
+}
+
+void AQIValueCache::lookup() {
+  if (!aqiMgr) return;
+  const AQIReadings& r = aqiMgr->getLastReadings();
+  if (isCurrent(r)) _stats.hits++;
+  else { _stats.misses++; fill(r); }
+}
+
+void AQIValueCache::fill(const AQIReadings& r) {
+  _derived.instantAQI = DerivedAQI::aqiForPM25(r.env.pm25);
+  _derived.nowCastAQI = (nowCast && nowCast->available()) ?
+    DerivedAQI::aqiForPM25(nowCast->pm25()) : DerivedAQI::NoAQI;
+  _derived.aqi = (useNowCast && _derived.nowCastAQI != DerivedAQI::NoAQI) ?
+    _derived.nowCastAQI : _derived.instantAQI;
+  _derived.bracket = DerivedAQI::bracketFor(_derived.aqi);
+  _derived.color = aqiMgr->colorForQuality(_derived.aqi);
+
+  const uint16_t raw[NowCastAQI] = {
+    _derived.aqi,
+    r.standard.pm10, r.standard.pm25, r.standard.pm100,
+    r.env.pm10, r.env.pm25, r.env.pm100,
+    r.particles_03um, r.particles_05um, r.particles_10um,
+    r.particles_25um, r.particles_50um, r.particles_100um
+  };
+  for (int i = 0; i < NowCastAQI; i++) {
+    snprintf(values[i], ValueSize, "%u", (unsigned)raw[i]);
+  }
+  if (_derived.nowCastAQI != DerivedAQI::NoAQI) {
+    snprintf(values[NowCastAQI], ValueSize, "%u", (unsigned)_derived.nowCastAQI);
+  } else {
+    snprintf(values[NowCastAQI], ValueSize, "N/A");
+  }
+  snprintf(time, TimeSize, "%s",
+    Output::formattedTime(Basics::wallClockFromMillis(r.timestamp)).c_str());
+
+  timestamp = r.timestamp;
+  if (nowCast) nowCastGeneration = nowCast->generation();
+  filled = true;
+  _stats.fills++;
+}
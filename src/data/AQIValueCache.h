@@ -0,0 +1,103 @@
+/*
+ * AQIValueCache
+ *    Holds pre-formatted versions of the most recent AQI readings along with
+ *    the values derived from them
+ *
+ * NOTES:
+ * o Many consumers (plugins via the DataBroker, the Web UI, screens) ask for
+ *   the same values over and over between readings. Rather than formatting a
+ *   value each time it is requested, the cache formats every field once per
+ *   reading generation (identified by AQIReadings::timestamp) and consumers
+ *   simply copy the bytes.
+ * o refresh() should be called whenever the AQIMgr may have accepted a new
+ *   frame. If a consumer asks for a value and the readings have moved on
+ *   without a refresh(), the cache fills itself and counts a miss. In steady
+ *   state the miss count should not move and no formatting happens during
+ *   lookups.
+ * o The DerivedAQI snapshot (AQI, category, color) is computed in the same
+ *   fill, so consumers never evaluate the AQI themselves.
+ * o The AQI is either the instantaneous AQI or, if selected with
+ *   setUseNowCast(), the NowCast AQI. The NowCast AQI is always available
+ *   separately as the NowCastAQI field.
+ * o The NowCast changes when an hour closes or its state is restored, not
+ *   only when a reading arrives, so the cache is also stale whenever the
+ *   NowCast's generation() has moved on since the last fill.
+ *
+ */
+
+#ifndef AQIValueCache_h
+#define AQIValueCache_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  WebThing Includes
+#include <sensors/AQIMgr.h>
+//                                  Local Includes
+#include "DerivedAQI.h"
+#include "NowCast.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class AQIValueCache {
+public:
+  enum Field : uint8_t {
+    AQI,
+    PM10Std, PM25Std, PM100Std,
+    PM10Env, PM25Env, PM100Env,
+    P03, P05, P10, P25, P50, P100,
+    NowCastAQI,
+    Timestamp,
+    NFields
+  };
+
+  struct Stats {
+    uint32_t hits;    // Lookups satisfied directly from the cache
+    uint32_t misses;  // Lookups that found stale values and had to fill the cache
+    uint32_t fills;   // Number of times the values were (re)formatted
+  };
+
+  void begin(AQIMgr* mgr, const NowCast* nc) { aqiMgr = mgr; nowCast = nc; }
+
+  // Selects which AQI the AQI field holds. Takes effect immediately.
+  void setUseNowCast(bool use) { useNowCast = use; filled = false; }
+
+
+  // Reformat the values if the AQIMgr has a newer reading than the cache,
+  // or the NowCast has changed. Returns true if the values were reformatted.
+  bool refresh();
+
+  // Returns the formatted value of the given field. The pointer is valid
+  // until the next refresh() or lookup that finds stale data.
+  const char* value(Field f);
+
+  // Returns the values derived from the latest readings
+  const DerivedAQI& derived();
+
+  const Stats& stats() const { return _stats; }
+
+private:
+  static constexpr size_t ValueSize = 6;  // Enough for a uint16_t and a NUL
+  static constexpr size_t TimeSize = 32;
+
+  AQIMgr* aqiMgr = nullptr;
+  const NowCast* nowCast = nullptr;
+  bool useNowCast = false;
+  uint32_t timestamp = 0;
+  uint16_t nowCastGeneration = 0;
+  bool filled = false;
+  DerivedAQI _derived;
+  char values[Timestamp][ValueSize];
+  char time[TimeSize];
+  Stats _stats = {0, 0, 0};
+
+  bool isCurrent(const AQIReadings& r) const {
+    return filled && r.timestamp == timestamp &&
+           (!nowCast || nowCast->generation() == nowCastGeneration);
+  }
+  void lookup();
+  void fill(const AQIReadings& r);
+};
+
+#endif  // AQIValueCache_h
@@ -0,0 +1,69 @@
+/*
+ * AdaptiveCadence
+ *    Chooses how often readings should be taken and published
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "AdaptiveCadence.h"
+#include "DerivedAQI.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+void AdaptiveCadence::observe(uint32_t ms, uint16_t pm25) {
+  if (!primed) {
+    _level = windowLevel = pm25;
+    bracket = DerivedAQI::bracketFor(DerivedAQI::aqiForPM25(pm25));
+    lastObservation = windowStart = ms;
+    primed = true;
+    return;
+  }
+
+  float dt = ms - lastObservation;
+  lastObservation = ms;
+  _level += (pm25 - _level) * (dt / (Smoothing + dt));
+
+  uint8_t b = DerivedAQI::bracketFor(DerivedAQI::aqiForPM25(lroundf(_level)));
+  if (b != bracket) {
+    bracket = b;
+    tighten(ms);
+  }
+
+  uint32_t elapsed = ms - windowStart;
+  if (elapsed < RateWindow) return;
+  _rate = (_level - windowLevel) * (60 * 1000.0f) / elapsed;
+  windowStart = ms;
+  windowLevel = _level;
+
+  if (_rate > RisingFast || fabsf(_rate) > 2 * RisingFast) tighten(ms);
+  else relax(ms);
+}
+
+void AdaptiveCadence::tighten(uint32_t ms) {
+  _interval = MinInterval;
+  lastTrigger = ms;
+  triggered = true;
+}
+
+void AdaptiveCadence::relax(uint32_t ms) {
+  if (triggered && ms - lastTrigger < HoldTime) return;
+  triggered = false;
+
+  bool quiet = (bracket == 0 && fabsf(_rate) < StableRate);
+  uint32_t ceiling = quiet ? MaxInterval : DefaultInterval;
+  if (_interval > ceiling) _interval = ceiling;
+  else if (_interval < ceiling) {
+    _interval *= 2;
+    if (_interval > ceiling) _interval = ceiling;
+  }
+}
+
+void AdaptiveCadence::resume(uint32_t interval) {
+  if (interval < MinInterval) interval = MinInterval;
+  else if (interval > MaxInterval) interval = MaxInterval;
+  _interval = interval;
+}
@@ -0,0 +1,74 @@
+/*
+ * AdaptiveCadence
+ *    Chooses how often readings should be taken and published based on how
+ *    volatile PM2.5 is
+ *
+ * NOTES:
+ * o observe() is given every frame the sensor produces. It keeps a
+ *   smoothed PM2.5 level and, every RateWindow, the rate at which that
+ *   level is changing.
+ * o The interval tightens to MinInterval (1 Hz) immediately when the
+ *   smoothed level moves into a different AQI category, or when it is
+ *   rising faster than RisingFast. It stays there for at least HoldTime.
+ * o After that it relaxes by doubling once per RateWindow: up to
+ *   MaxInterval when the air is Good and stable, and up to DefaultInterval
+ *   otherwise. Tightening is immediate and relaxing is gradual, so a smoke
+ *   event is caught as it starts while a quiet day costs little.
+ * o The app uses interval() as the aggregation interval for sensor frames
+ *   and to space out AIO publishing. Putting the sensor to sleep between
+ *   samples is up to the caller.
+ *
+ */
+
+#ifndef AdaptiveCadence_h
+#define AdaptiveCadence_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class AdaptiveCadence {
+public:
+  static constexpr uint32_t MinInterval = 1000;                 // ms
+  static constexpr uint32_t DefaultInterval = 60 * 1000L;       // ms
+  static constexpr uint32_t MaxInterval = 5 * 60 * 1000L;       // ms
+  static constexpr uint32_t RateWindow = 15 * 1000L;            // ms
+  static constexpr uint32_t HoldTime = 2 * 60 * 1000L;          // ms
+  static constexpr float    Smoothing = 10 * 1000.0f;           // Time constant, ms
+  static constexpr float    RisingFast = 3.0f;                  // ug/m3 per minute
+  static constexpr float    StableRate = 0.5f;                  // ug/m3 per minute
+
+  // Folds in a PM2.5 reading (ug/m3) taken at time ms (millis())
+  void observe(uint32_t ms, uint16_t pm25);
+
+  // The interval at which readings should currently be taken, in ms
+  uint32_t interval() const { return _interval; }
+
+  // Continues with an interval chosen before a restart (e.g. deep sleep).
+  // The level and rate are rebuilt from the readings that follow.
+  void resume(uint32_t interval);
+
+  float level() const { return _level; }
+  float rate() const { return _rate; }     // ug/m3 per minute
+
+private:
+  bool primed = false;
+  uint32_t _interval = DefaultInterval;
+  float _level = 0;
+  float _rate = 0;
+  uint8_t bracket = 0;
+  uint32_t lastObservation = 0;
+  uint32_t windowStart = 0;
+  float windowLevel = 0;
+  uint32_t lastTrigger = 0;
+  bool triggered = false;
+
+  void tighten(uint32_t ms);
+  void relax(uint32_t ms);
+};
+
+#endif  // AdaptiveCadence_h
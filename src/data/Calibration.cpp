@@ -0,0 +1,49 @@
+/*
+ * Calibration
+ *    Per-channel gain and offset corrections, applied in fixed point as
+ *    readings are taken
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+//                                  Local Includes
+#include "Calibration.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  const char* const Names[Calibration::NChannels] = {
+    "temp", "humi", "pres", "pm10", "pm25", "pm100"
+  };
+}
+
+const char* Calibration::name(Channel c) { return Names[c]; }
+
+void Calibration::set(Channel c, float gain, float offset) {
+  coefficients[c].gain = lroundf(gain * Unity);
+  coefficients[c].offset = lroundf(offset * 100);
+}
+
+float Calibration::apply(Channel c, float v) const {
+  if (isnan(v)) return v;
+  return apply(c, (int32_t)lroundf(v * 100)) / 100.0f;
+}
+
+void Calibration::apply(AQIReadings& r) const {
+  r.standard.pm10 = applyPM(PM10, r.standard.pm10);
+  r.standard.pm25 = applyPM(PM25, r.standard.pm25);
+  r.standard.pm100 = applyPM(PM100, r.standard.pm100);
+  r.env.pm10 = applyPM(PM10, r.env.pm10);
+  r.env.pm25 = applyPM(PM25, r.env.pm25);
+  r.env.pm100 = applyPM(PM100, r.env.pm100);
+}
+
+// Concentrations are whole ug/m3 and can't be negative
+uint16_t Calibration::applyPM(Channel c, uint16_t v) const {
+  int32_t corrected = apply(c, (int32_t)v * 100);
+  if (corrected <= 0) return 0;
+  corrected = (corrected + 50) / 100;
+  return corrected > UINT16_MAX ? UINT16_MAX : corrected;
+}
@@ -0,0 +1,72 @@
+/*
+ * Calibration
+ *    Per-channel gain and offset corrections, applied in fixed point as
+ *    readings are taken
+ *
+ * NOTES:
+ * o Each channel has a gain and an offset: corrected = raw * gain + offset.
+ *   They come from the user's settings as floats and are converted once,
+ *   in set(), to a gain in units of 1/Unity and an offset in hundredths of
+ *   the channel's unit (Celsius, percent, hPa, or ug/m3).
+ * o Applying a correction is one 32x32->64 bit multiply, a shift, and an
+ *   add on hundredths, so it is the same for every channel and involves no
+ *   float math.
+ * o The app applies the corrections at ingestion: PM readings as each
+ *   frame arrives from the sensors and weather readings as WeatherMgr takes
+ *   them from WeatherSampler. Everything downstream (history, AIO, the
+ *   screens and web pages) sees corrected values.
+ * o Each PM gain and offset applies to both the standard (CF=1) and the
+ *   environmental value of that particle size. Particle counts are not
+ *   corrected.
+ *
+ */
+
+#ifndef Calibration_h
+#define Calibration_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  WebThing Includes
+#include <sensors/AQIMgr.h>
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class Calibration {
+public:
+  enum Channel : uint8_t { Temp, Humi, Pressure, PM10, PM25, PM100, NChannels };
+
+  static constexpr uint8_t GainBits = 16;
+  static constexpr int32_t Unity = 1L << GainBits;
+
+  // The name used for the channel in settings and in the web UI
+  static const char* name(Channel c);
+
+  // gain is a multiplier and offset is in the channel's unit
+  void set(Channel c, float gain, float offset);
+
+  // Applies the correction for c to v, which is in hundredths of the
+  // channel's unit. The result is also in hundredths.
+  int32_t apply(Channel c, int32_t v) const {
+    const Coefficients& k = coefficients[c];
+    return (int32_t)(((int64_t)v * k.gain + Unity/2) >> GainBits) + k.offset;
+  }
+
+  // Corrects a weather reading. NaN is passed through.
+  float apply(Channel c, float v) const;
+
+  // Corrects the PM mass concentrations of r
+  void apply(AQIReadings& r) const;
+
+private:
+  struct Coefficients {
+    int32_t gain = Unity;
+    int32_t offset = 0;   // Hundredths
+  };
+  Coefficients coefficients[NChannels];
+
+  uint16_t applyPM(Channel c, uint16_t v) const;
+};
+
+#endif  // Calibration_h
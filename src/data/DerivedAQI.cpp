@@ -0,0 +1,87 @@
+/*
+ * DerivedAQI
+ *    The values derived from a set of AQI readings
+ *
+ * NOTES:
+ * o The breakpoints are the ones the chart page uses (see calcAQI() in
+ *   ChartPage.html). Concentrations are in tenths of a ug/m3.
+ * o The table matches AQIMgr::derivedAQI up to 250 ug/m3. Above that,
+ *   derivedAQI ran off the end of its breakpoints and reported 500, while the
+ *   table interpolates the last breakpoint up to 500 ug/m3. The check in
+ *   tools/bench/AQITableCheck.cpp compares the two.
+ * o Everything used to build the table is C++11 constexpr since the ESP32
+ *   toolchain still compiles with -std=gnu++11.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "DerivedAQI.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  struct Breakpoint {
+    uint16_t pmLo, pmHi;    // Tenths of a ug/m3
+    uint16_t aqiLo, aqiHi;
+  };
+
+  constexpr Breakpoint Breakpoints[] = {
+    {   0,  154,   0,  50},
+    { 155,  404,  51, 100},
+    { 405,  654, 101, 150},
+    { 655, 1504, 151, 200},
+    {1505, 2504, 201, 300},
+    {2505, 5004, 301, 500}
+  };
+  constexpr uint8_t NBreakpoints = sizeof(Breakpoints)/sizeof(Breakpoints[0]);
+  constexpr uint16_t MaxPM25 = Breakpoints[NBreakpoints-1].pmHi / 10;   // Whole ug/m3
+  constexpr uint16_t MaxAQI = Breakpoints[NBreakpoints-1].aqiHi;
+
+  // Index of the breakpoint whose range includes pm (tenths)
+  constexpr uint8_t rowForPM(uint16_t pm, uint8_t row = 0) {
+    return (row == NBreakpoints - 1 || pm <= Breakpoints[row].pmHi) ? row : rowForPM(pm, row + 1);
+  }
+
+  constexpr uint16_t interpolate(uint16_t pm, const Breakpoint& b) {
+    return (uint32_t)(pm - b.pmLo) * (b.aqiHi - b.aqiLo) / (b.pmHi - b.pmLo) + b.aqiLo;
+  }
+
+  constexpr uint16_t computeAQI(uint16_t pm25) {
+    return interpolate(pm25 * 10, Breakpoints[rowForPM(pm25 * 10)]);
+  }
+
+  // ----- C++11 stand-ins for std::index_sequence
+  template <size_t... I> struct Indices { };
+  template <size_t N, size_t... I> struct MakeIndices : MakeIndices<N-1, N-1, I...> { };
+  template <size_t... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+  struct AQILookup { uint16_t aqi[MaxPM25 + 1]; };
+
+  template <size_t... I>
+  constexpr AQILookup makeLookup(Indices<I...>) { return {{ computeAQI(I)... }}; }
+
+  constexpr AQILookup Lookup PROGMEM = makeLookup(MakeIndices<MaxPM25 + 1>::type());
+
+  static_assert(Lookup.aqi[0] == 0, "AQI table is wrong");
+  static_assert(Lookup.aqi[15] == 48, "AQI table is wrong");
+  static_assert(Lookup.aqi[16] == 51, "AQI table is wrong");
+  static_assert(Lookup.aqi[100] == 170, "AQI table is wrong");
+  static_assert(Lookup.aqi[MaxPM25] == 499, "AQI table is wrong");
+
+  constexpr uint8_t rowForAQI(uint16_t aqi, uint8_t row = 0) {
+    return (row == NBreakpoints - 1 || aqi <= Breakpoints[row].aqiHi) ? row : rowForAQI(aqi, row + 1);
+  }
+}
+
+uint16_t DerivedAQI::aqiForPM25(uint16_t pm25) {
+  if (pm25 > MaxPM25) return MaxAQI;
+  return pgm_read_word(&Lookup.aqi[pm25]);
+}
+
+uint8_t DerivedAQI::bracketFor(uint16_t aqi) {
+  return rowForAQI(aqi);
+}
@@ -0,0 +1,43 @@
+/*
+ * DerivedAQI
+ *    The values derived from a set of AQI readings: the AQI itself, its EPA
+ *    category, and the color that represents it
+ *
+ * NOTES:
+ * o A DerivedAQI is computed once per reading by AQIValueCache and shared
+ *   by every consumer (screens, indicators, web pages, data supplier), so
+ *   none of them evaluate the AQI breakpoints themselves.
+ * o aqiForPM25() is a lookup into a table with one entry per ug/m3 that is
+ *   built by the compiler from the EPA breakpoints. There is no arithmetic
+ *   at run time.
+ *
+ */
+
+#ifndef DerivedAQI_h
+#define DerivedAQI_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+struct DerivedAQI {
+  static constexpr uint16_t NoAQI = 0xffff;
+
+  uint16_t aqi;         // The AQI to report: instantaneous or NowCast, per the settings
+  uint16_t instantAQI;  // The AQI of the latest reading's PM2.5
+  uint16_t nowCastAQI;  // The NowCast AQI, or NoAQI if it isn't available yet
+  uint8_t  bracket;     // EPA category of aqi: 0 (Good) .. 5 (Hazardous)
+  uint32_t color;       // Color representing aqi
+
+  // The AQI for a PM2.5 concentration in ug/m3
+  static uint16_t aqiForPM25(uint16_t pm25);
+
+  // The EPA category of an AQI value: 0 (Good) .. 5 (Hazardous)
+  static uint8_t bracketFor(uint16_t aqi);
+};
+
+#endif  // DerivedAQI_h
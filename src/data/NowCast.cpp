@@ -0,0 +1,108 @@
+/*
+ * NowCast
+ *    Computes the EPA NowCast for PM2.5
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+#include <string.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "NowCast.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+void NowCast::add(uint32_t ts, uint16_t pm25, uint16_t weight) {
+  if (!advance(ts)) return;
+  sum += (uint32_t)pm25 * weight;
+  count += weight;
+}
+
+void NowCast::loop(uint32_t now) {
+  advance(now);
+}
+
+void NowCast::save(State& s) const {
+  memcpy(s.hourly, hourly, sizeof(hourly));
+  s.start = start;
+  s.sum = sum;
+  s.count = count;
+  s.pm25x10 = _pm25x10;
+  s.newest = newest;
+  s.filled = filled;
+}
+
+void NowCast::resume(const State& s) {
+  if (s.newest >= Hours || s.filled > Hours) return;
+  memcpy(hourly, s.hourly, sizeof(hourly));
+  start = s.start;
+  sum = s.sum;
+  count = s.count;
+  _pm25x10 = s.pm25x10;
+  newest = s.newest;
+  filled = s.filled;
+  _generation++;
+}
+
+// Moves to the hour containing ts, closing the current hour (and recording
+// any skipped hours as missing) if ts is beyond it. Returns false if ts
+// can't be recorded.
+bool NowCast::advance(uint32_t ts) {
+  if (ts < MinValidTime) return false;
+  uint32_t hourStart = ts - (ts % HourLength);
+  if (hourStart < start) return false;
+  if (hourStart == start) return true;
+
+  if (start) {
+    push(count ? (sum * 10 + count/2) / count : NoData);
+    uint32_t skipped = (hourStart - start) / HourLength - 1;
+    for (uint32_t i = 0; i < skipped && i < Hours; i++) push(NoData);
+    compute();
+  }
+  start = hourStart;
+  sum = 0;
+  count = 0;
+  return true;
+}
+
+void NowCast::push(uint16_t average) {
+  newest = (newest + 1) % Hours;
+  hourly[newest] = average;
+  if (filled < Hours) filled++;
+}
+
+// The average for the hour that closed i hours before the newest one
+uint16_t NowCast::hoursAgo(uint8_t i) const {
+  if (i >= filled) return NoData;
+  return hourly[(newest + Hours - i) % Hours];
+}
+
+void NowCast::compute() {
+  _generation++;
+  uint8_t recent = 0;
+  for (uint8_t i = 0; i < 3; i++) if (hoursAgo(i) != NoData) recent++;
+  if (recent < 2) { _pm25x10 = NoData; return; }
+
+  uint16_t cMin = NoData, cMax = 0;
+  for (uint8_t i = 0; i < filled; i++) {
+    uint16_t c = hoursAgo(i);
+    if (c == NoData) continue;
+    if (c < cMin) cMin = c;
+    if (c > cMax) cMax = c;
+  }
+  if (cMax == 0) { _pm25x10 = 0; return; }
+
+  float w = (float)cMin / cMax;
+  if (w < 0.5f) w = 0.5f;
+
+  float weighted = 0, weights = 0, wi = 1;
+  for (uint8_t i = 0; i < filled; i++, wi *= w) {
+    uint16_t c = hoursAgo(i);
+    if (c == NoData) continue;
+    weighted += wi * c;
+    weights += wi;
+  }
+  _pm25x10 = (uint16_t)floorf(weighted / weights);
+}
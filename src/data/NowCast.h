@@ -0,0 +1,98 @@
+/*
+ * NowCast
+ *    Computes the EPA NowCast for PM2.5, the 12 hour weighted average that
+ *    AirNow uses to report current air quality
+ *
+ * NOTES:
+ * o Concentrations are accumulated into an average for the current clock
+ *   hour. When the hour ends its average is pushed into a ring holding the
+ *   last 12 hourly averages and the NowCast is recomputed from the ring.
+ *   Nothing else is kept, so the result never requires a pass over the
+ *   app's history and reading it costs nothing.
+ * o Hours with no readings are recorded as missing. As specified by the
+ *   EPA, the NowCast is only available when at least 2 of the 3 most
+ *   recent hours have data.
+ * o Hourly averages and the result are kept in tenths of a ug/m3. The
+ *   result is truncated to one decimal place, as AirNow does.
+ *
+ */
+
+#ifndef NowCast_h
+#define NowCast_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class NowCast {
+public:
+  static constexpr uint8_t Hours = 12;
+
+  // Add a PM2.5 concentration (ug/m3) measured at wall clock time ts.
+  // Readings older than the hour being accumulated are ignored. weight is
+  // the number of frames the value stands for, so that averages over
+  // intervals of different lengths are combined fairly.
+  void add(uint32_t ts, uint16_t pm25, uint16_t weight = 1);
+
+  // Closes the current hour if it has ended by wall clock time now, even if
+  // no new readings have arrived
+  void loop(uint32_t now);
+
+  bool available() const { return _pm25x10 != NoData; }
+
+  // The NowCast concentration in tenths of a ug/m3, or NoData
+  uint16_t pm25x10() const { return _pm25x10; }
+
+  // The NowCast concentration rounded to a whole ug/m3, suitable for
+  // DerivedAQI::aqiForPM25(). Only meaningful if available().
+  uint16_t pm25() const { return (_pm25x10 + 5) / 10; }
+
+  // Changes every time the result is recomputed (as each hour closes) or
+  // replaced by resume(), so that anything derived from it can tell when
+  // it is out of date
+  uint16_t generation() const { return _generation; }
+
+  static constexpr uint16_t NoData = 0xffff;
+
+  // Everything the NowCast knows, so that it can be carried across a
+  // restart (e.g. deep sleep) and continued with resume()
+  struct State {
+    uint16_t hourly[Hours];
+    uint32_t start;
+    uint32_t sum;
+    uint16_t count;
+    uint16_t pm25x10;
+    uint8_t newest;
+    uint8_t filled;
+  };
+
+  void save(State& s) const;
+  void resume(const State& s);
+
+private:
+  // Readings taken before the clock has been set are not recorded
+  static constexpr uint32_t MinValidTime = 1577836800;  // 2020-01-01
+  static constexpr uint32_t HourLength = 60 * 60;
+
+  uint16_t hourly[Hours];   // Averages in tenths; NoData if the hour had none
+  uint8_t newest = 0;       // Index of the most recently closed hour
+  uint8_t filled = 0;       // Number of hours that have been closed
+
+  uint32_t start = 0;       // Start of the hour being accumulated, 0 if none
+  uint32_t sum = 0;
+  uint16_t count = 0;
+
+  uint16_t _pm25x10 = NoData;
+  uint16_t _generation = 0;
+
+  bool advance(uint32_t ts);
+  void push(uint16_t average);
+  void compute();
+  uint16_t hoursAgo(uint8_t i) const;
+};
+
+#endif  // NowCast_h
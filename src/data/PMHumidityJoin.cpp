@@ -0,0 +1,37 @@
+/*
+ * PMHumidityJoin
+ *    Pairs PM readings with the humidity measured alongside them and
+ *    produces the EPA's humidity-corrected PM2.5
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+//                                  Local Includes
+#include "PMHumidityJoin.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+uint16_t PMHumidityJoin::correct(const AQIReadings& r) {
+  _latest = NoValue;
+  if (!sampler) return _latest;
+
+  const WeatherSampler::Sample& s = sampler->latest();
+  if (s.timestamp == 0 || isnan(s.humi)) return _latest;
+  uint32_t skew = (r.timestamp > s.timestamp) ? r.timestamp - s.timestamp : s.timestamp - r.timestamp;
+  if (skew > MaxSkew) return _latest;
+
+  float rh = cal ? cal->apply(Calibration::Humi, s.humi) : s.humi;
+  _latest = epaPM25x10(r.standard.pm25, rh);
+  return _latest;
+}
+
+uint16_t PMHumidityJoin::epaPM25x10(uint16_t pm25cf1, float rh) {
+  if (rh < 0) rh = 0;
+  else if (rh > 100) rh = 100;
+  float corrected = 0.524f * pm25cf1 - 0.0862f * rh + 5.75f;
+  if (corrected <= 0) return 0;
+  if (corrected >= (NoValue - 1) / 10.0f) return NoValue - 1;
+  return lroundf(corrected * 10);
+}
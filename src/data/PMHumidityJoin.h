@@ -0,0 +1,60 @@
+/*
+ * PMHumidityJoin
+ *    Pairs PM readings with the humidity measured alongside them and
+ *    produces the EPA's humidity-corrected PM2.5
+ *
+ * NOTES:
+ * o The PMS5003 counts water droplets as particles, so it over-reports
+ *   badly when the air is humid. The EPA's US-wide correction for
+ *   PurpleAir sensors (Barkjohn et al., 2021) uses the sensor's CF=1 PM2.5
+ *   and the relative humidity:
+ *       PM2.5 = 0.524 * PM2.5(CF=1) - 0.0862 * RH + 5.75
+ *   The result is clamped at 0.
+ * o Readings are joined at ingestion. When an aggregate is formed, the
+ *   humidity sample nearest to it in time is WeatherSampler's latest one,
+ *   since no later sample exists yet. Looking it up is O(1). If that sample
+ *   is more than MaxSkew old, or has no humidity, there is no corrected
+ *   value.
+ * o The humidity is calibrated the same way as the value WeatherMgr sees.
+ *
+ */
+
+#ifndef PMHumidityJoin_h
+#define PMHumidityJoin_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  WebThing Includes
+#include <sensors/AQIMgr.h>
+//                                  Local Includes
+#include "Calibration.h"
+#include "../hardware/WeatherSampler.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class PMHumidityJoin {
+public:
+  static constexpr uint16_t NoValue = 0xffff;
+  static constexpr uint32_t MaxSkew = 2 * WeatherSampler::SampleInterval;  // ms
+
+  void begin(const WeatherSampler* sampler, const Calibration* cal) {
+    this->sampler = sampler;
+    this->cal = cal;
+  }
+
+  // The corrected PM2.5 for r, in tenths of a ug/m3, or NoValue. The result
+  // is also kept as latest().
+  uint16_t correct(const AQIReadings& r);
+  uint16_t latest() const { return _latest; }
+
+  // The correction itself. pm25cf1 is in ug/m3 and rh in percent.
+  static uint16_t epaPM25x10(uint16_t pm25cf1, float rh);
+
+private:
+  const WeatherSampler* sampler = nullptr;
+  const Calibration* cal = nullptr;
+  uint16_t _latest = NoValue;
+};
+
+#endif  // PMHumidityJoin_h
@@ -0,0 +1,61 @@
+/*
+ * SleepState
+ *    Carries the app's working state across deep sleep in RTC memory
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+#include <stddef.h>
+#include <string.h>
+//                                  Local Includes
+#include "SleepState.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  #if defined(ESP8266)
+    constexpr uint32_t FirstRTCBlock = 128 / 4;     // Past the OTA updater's area
+    constexpr size_t RTCCapacity = 512 - 128;
+    static_assert(sizeof(SleepState::Block) <= RTCCapacity, "SleepState::Block doesn't fit in RTC memory");
+    static_assert(sizeof(SleepState::Block) % 4 == 0, "RTC memory is read and written in words");
+  #else
+    RTC_NOINIT_ATTR SleepState::Block rtcBlock;
+  #endif
+}
+
+void SleepState::save() {
+  block.magic = Magic;
+  block.crc = crc(block);
+  #if defined(ESP8266)
+    ESP.rtcUserMemoryWrite(FirstRTCBlock, (uint32_t*)&block, sizeof(block));
+  #else
+    memcpy(&rtcBlock, &block, sizeof(block));
+  #endif
+}
+
+bool SleepState::take() {
+  #if defined(ESP8266)
+    if (!ESP.rtcUserMemoryRead(FirstRTCBlock, (uint32_t*)&block, sizeof(block))) return false;
+    uint32_t invalid = 0;
+    ESP.rtcUserMemoryWrite(FirstRTCBlock, &invalid, sizeof(invalid));
+  #else
+    memcpy(&block, &rtcBlock, sizeof(block));
+    rtcBlock.magic = 0;
+  #endif
+  return block.magic == Magic && block.nTail <= TailRecords && block.crc == crc(block);
+}
+
+// CRC-32 (IEEE), bit at a time. The block is small enough that a table
+// isn't worth the memory.
+uint32_t SleepState::crc(const Block& b) {
+  const uint8_t* p = (const uint8_t*)&b + offsetof(Block, flags);
+  size_t n = sizeof(Block) - offsetof(Block, flags);
+  uint32_t c = 0xffffffff;
+  while (n--) {
+    c ^= *p++;
+    for (uint8_t k = 0; k < 8; k++) c = (c >> 1) ^ (0xedb88320 & (0 - (c & 1)));
+  }
+  return ~c;
+}
@@ -0,0 +1,76 @@
+/*
+ * SleepState
+ *    Carries the app's working state across deep sleep in RTC memory
+ *
+ * NOTES:
+ * o Deep sleep ends in a restart, so everything in RAM is lost: the last
+ *   readings, the periods History and the NowCast are part way through,
+ *   and any history records not yet written to flash. Rebuilding all of
+ *   that from the sensor takes minutes.
+ * o Before sleeping the app fills in a Block and save()s it to RTC memory,
+ *   which keeps its contents through deep sleep. On wake, take() reads it
+ *   back and checks its magic and CRC. A good block is consumed:
+ *   it is invalidated as it is taken so that a later reset doesn't replay
+ *   it. Both steps take microseconds.
+ * o On ESP8266 the block lives in the RTC user memory, starting past the
+ *   first 128 bytes, which the OTA updater uses. That leaves 384 bytes, so
+ *   only TailRecords of the unwritten history records fit. If there are
+ *   more the app writes them to flash instead. On ESP32 the block is
+ *   placed in RTC slow memory, which has room for a whole batch.
+ * o The block is only meaningful to the firmware that wrote it. Magic
+ *   includes a layout version and changes whenever the layout does.
+ *
+ */
+
+#ifndef SleepState_h
+#define SleepState_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  Local Includes
+#include "NowCast.h"
+#include "../history/History.h"
+#include "../history/HistoryLog.h"
+#include "../sensors/PMS5003Parser.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class SleepState {
+public:
+  #if defined(ESP8266)
+    static constexpr uint8_t TailRecords = 5;
+  #else
+    static constexpr uint8_t TailRecords = HistoryLog::BatchSize;
+  #endif
+
+  enum Flags : uint8_t { HasAQI = 0x01 };
+
+  struct Block {
+    uint32_t magic;
+    uint32_t crc;               // Of everything that follows it
+    uint8_t  flags;
+    uint8_t  nTail;
+    uint16_t aqi[PMS5003Parser::NFields];   // The last readings, if HasAQI
+    uint32_t interval;          // The adaptive cadence's interval, ms
+    NowCast::State nowCast;
+    History::Progress history;
+    HistoryLog::Record tail[TailRecords];   // Unwritten history records
+  };
+
+  Block block;
+
+  // Writes block to RTC memory
+  void save();
+
+  // Reads block from RTC memory and invalidates the copy there. Returns
+  // false, leaving block undefined, if there was no valid block.
+  bool take();
+
+private:
+  static constexpr uint32_t Magic = 0x33535350;   // "PSS3"
+
+  static uint32_t crc(const Block& b);
+};
+
+#endif  // SleepState_h
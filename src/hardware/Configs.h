@@ -377,6 +377,12 @@
     #define PMS5003_READINGS PMS5003_AVAIL_READINGS
     constexpr Basics::Pin SENSOR_RX_PIN = 16;
     constexpr Basics::Pin SENSOR_TX_PIN = 17;
+    #if (AQI_SENSOR_2 == PRESENT)
+      // A second sensor on UART 2. Its readings are averaged with the first.
+      #define N_AQI_SENSORS 2
+      constexpr Basics::Pin SENSOR_2_RX_PIN = 25;
+      constexpr Basics::Pin SENSOR_2_TX_PIN = 26;
+    #endif
   #elif (AQI_SENSOR == MOCK)
     #define PMS5003_READINGS PMS5003_AVAIL_READINGS
     constexpr Basics::Pin SENSOR_RX_PIN = Basics::UnusedPin;
@@ -435,6 +441,12 @@
     #define PMS5003_READINGS PMS5003_AVAIL_READINGS
     constexpr Basics::Pin SENSOR_RX_PIN = 16;
     constexpr Basics::Pin SENSOR_TX_PIN = 17;
+    #if (AQI_SENSOR_2 == PRESENT)
+      // A second sensor on UART 2. Its readings are averaged with the first.
+      #define N_AQI_SENSORS 2
+      constexpr Basics::Pin SENSOR_2_RX_PIN = 25;
+      constexpr Basics::Pin SENSOR_2_TX_PIN = 26;
+    #endif
   #elif (AQI_SENSOR == MOCK)
     #define PMS5003_READINGS PMS5003_AVAIL_READINGS
     constexpr Basics::Pin SENSOR_RX_PIN = Basics::UnusedPin;
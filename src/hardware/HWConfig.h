@@ -57,11 +57,13 @@
 //------------------------------------------------------------------------------
 // Choose a base configuration and the specific devices
 // that are present on your particular board. For the BME and AQI sensors you
-// may choose PRESENT, MOCK, or leave it undefined.
+// may choose PRESENT, MOCK, or leave it undefined. ESP32 configs may also
+// define AQI_SENSOR_2 as PRESENT if a second PMS5003 is attached.
 
 #define BaseConfig  Config_PH2_ESP32
 #define GUI_DSPLY   PRESENT
 #define AQI_SENSOR  PRESENT
+// #define AQI_SENSOR_2 PRESENT
 #define BME_SENSOR  PRESENT
 #define CTRL_BTNS   PRESENT
 
@@ -113,6 +115,14 @@
   #define HAS_AQI_SENSOR
 #endif
 
+#if !defined(N_AQI_SENSORS)
+  #define N_AQI_SENSORS 1
+#endif
+
+#if (N_AQI_SENSORS > 1) && defined(USE_SW_SERIAL)
+  #error("Multiple AQI sensors require hardware UARTs")
+#endif
+
 
 #if !defined(HAS_WEATHER_SENSOR) && !defined(HAS_AQI_SENSOR)
   #error("No sensors defined")
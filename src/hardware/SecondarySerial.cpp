@@ -0,0 +1,132 @@
+/*
+ * SecondarySerial
+ *    Owns the serial connections to the air quality sensors
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "SecondarySerial.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  struct SensorPins { Basics::Pin rx, tx; };
+
+  constexpr SensorPins Pins[SecondarySerial::NSensors] = {
+    {SENSOR_RX_PIN, SENSOR_TX_PIN},
+  #if (N_AQI_SENSORS > 1)
+    {SENSOR_2_RX_PIN, SENSOR_2_TX_PIN},
+  #endif
+  };
+}
+
+
+SecondarySerial::SecondarySerial() {
+  // Until the app says otherwise, AQIMgr sees the combined readings
+  sensors.setFrameHandler([this](const AQIReadings& r) { present(r); });
+}
+
+void SecondarySerial::begin() {
+  if (SENSOR_RX_PIN == Basics::UnusedPin) {
+    // We don't have a serial device. This might be used when mocking an implementation.
+    s = nullptr;
+    return;
+  }
+
+  for (uint8_t i = 0; i < NSensors; i++) {
+    PMS5003Link& link = links[i];
+    link.setFrameHandler([this, i](const AQIReadings& r) {
+      if (duty.accepting()) sensors.add(i, r);
+    });
+
+    #if defined(USE_SW_SERIAL)
+      SoftwareSerial* ss = new SoftwareSerial(Pins[i].rx, Pins[i].tx);
+      ss->begin(SensorBaudRate, SWSERIAL_8N1, -1, -1, false, DriverBufferSize);
+      devices[i] = ss;
+      link.attach(ss);
+    #else
+      HardwareSerial* hs = new HardwareSerial(1 + i);
+      hs->setRxBufferSize(DriverBufferSize);
+      hs->begin(SensorBaudRate, SERIAL_8N1, Pins[i].rx, Pins[i].tx);
+      devices[i] = hs;
+      #if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 2
+        // Drain the driver from its own event task as soon as data arrives
+        hs->onReceive([&link]() { link.drain(); });
+        hs->onReceiveError([&link](hardwareSerial_error_t e) {
+          if (e == UART_BUFFER_FULL_ERROR || e == UART_FIFO_OVF_ERROR) link.countDriverOverflow();
+        });
+        link.attach(hs, true);
+      #else
+        link.attach(hs);
+      #endif
+    #endif
+  }
+
+  s = links[0].stream();
+
+  // A sensor that can't be sent commands would keep streaming while the
+  // others slept, and its frames would be dropped, so either every sensor
+  // is duty-cycled or none is
+  for (uint8_t i = 0; i < NSensors; i++) {
+    if (Pins[i].tx == Basics::UnusedPin) {
+      Log.warning(F("SecondarySerial: sensor %d has no TX pin, streaming continuously"), i + 1);
+      return;
+    }
+  }
+  duty.begin(devices, NSensors);
+}
+
+void SecondarySerial::loop() {
+  for (uint8_t i = 0; i < NSensors; i++) {
+    if (!devices[i]) continue;
+    #if defined(USE_SW_SERIAL)
+      if (((SoftwareSerial*)devices[i])->overflow()) links[i].countDriverOverflow();
+    #endif
+    links[i].loop();
+  }
+  uint32_t now = millis();
+  duty.loop(now);
+
+  if (now - rateStart >= RateWindow) {
+    for (uint8_t i = 0; i < NSensors; i++) {
+      uint32_t frames = links[i].stats().framesAccepted;
+      rates[i] = (frames - rateFrames[i]) * 1000.0f / (now - rateStart);
+      rateFrames[i] = frames;
+    }
+    rateStart = now;
+  }
+}
+
+uint32_t SecondarySerial::frameAge(uint8_t i, uint32_t now) const {
+  const PMS5003Array::Channel& c = sensors.channel(i);
+  return c.frames ? now - c.latest.timestamp : UINT32_MAX;
+}
+
+uint8_t SecondarySerial::faults(uint32_t now) const {
+  if (duty.accepting()) return sensors.faults(now);
+
+  // Asleep or warming up, so no frames are expected
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < NSensors; i++) {
+    if (sensors.channel(i).drifting) mask |= (1 << i);
+  }
+  return mask;
+}
+
+SecondarySerial::Stats SecondarySerial::stats() const {
+  Stats total = {0, 0, 0, 0, 0};
+  for (uint8_t i = 0; i < NSensors; i++) {
+    Stats st = links[i].stats();
+    total.framesAccepted += st.framesAccepted;
+    total.checksumErrors += st.checksumErrors;
+    total.syncErrors += st.syncErrors;
+    total.resyncs += st.resyncs;
+    total.overflowBytes += st.overflowBytes;
+  }
+  return total;
+}
@@ -1,35 +1,107 @@
+/*
+ * SecondarySerial
+ *    Owns the serial connections to the air quality sensors
+ *
+ * NOTES:
+ * o The UART is not handed to AQIMgr directly. Bytes are moved into a ring
+ *   as they arrive: by the UART driver's receive callback on ESP32, and from
+ *   the (ISR-fed) SoftwareSerial buffer whenever loop() runs on ESP8266.
+ *   SoftwareSerial has no hook that runs in its ISR (its onReceive handler
+ *   is itself scheduled from loop()), so on ESP8266 its own buffer serves
+ *   as the interrupt-side ring. The driver buffers are enlarged so that
+ *   several seconds of frames survive a long web request or AIO publish.
+ *   See src/sensors/PMS5003Link.h.
+ * o s is the Stream to give AQIMgr. It only ever holds valid frames.
+ * o On ESP32 boards there may be N_AQI_SENSORS sensors, each on its own
+ *   hardware UART (1, 2, ...) with its own link. Their frames are combined
+ *   by a PMS5003Array, so AQIMgr and the frame handler still see a single
+ *   stream of readings. See src/sensors/PMS5003Array.h.
+ * o When readings are wanted less often than every couple of minutes the
+ *   sensors are slept between samples and read in passive mode, with
+ *   commands sent through each sensor's TX pin. If any sensor has no TX
+ *   pin, none of them is slept and they stream continuously, as is the case
+ *   in most of the configurations in Configs.h. setSampleInterval() tells
+ *   it how often readings are wanted. See src/sensors/PMS5003DutyCycle.h.
+ * o When there is no sensor (SENSOR_RX_PIN is unused, e.g. when mocking),
+ *   s is nullptr just as before.
+ *
+ */
+
 #ifndef SecondarySerial_h
 #define SecondarySerial_h
 
-#include "HWConfig.h"
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
 #if defined(USE_SW_SERIAL)
   #include <SoftwareSerial.h>
 #endif
+//                                  Local Includes
+#include "HWConfig.h"
+#include "../sensors/PMS5003Array.h"
+#include "../sensors/PMS5003DutyCycle.h"
+#include "../sensors/PMS5003Link.h"
+//--------------- End:    Includes ---------------------------------------------
+
 
 class SecondarySerial {
 public:
-  Stream* s;
-
-  void begin() {
-    if (SENSOR_RX_PIN == Basics::UnusedPin) {
-      // We don't have a serial device. This might be used when mocking an implementation.
-      s = nullptr;
-      return;
-    }
-    #if defined(USE_SW_SERIAL)
-      SoftwareSerial* ss = new SoftwareSerial(SENSOR_RX_PIN, SENSOR_TX_PIN);
-      ss->begin(SensorBaudRate);
-      s = ss;
-    #else
-      HardwareSerial* hs = new HardwareSerial(1);
-      hs->begin(SensorBaudRate, SERIAL_8N1, SENSOR_RX_PIN, SENSOR_TX_PIN);
-      s = hs;
-    #endif
+  using Stats = PMS5003Link::Stats;
+  using FrameHandler = PMS5003Array::FrameHandler;
+
+  static constexpr uint8_t NSensors = N_AQI_SENSORS;
+
+  Stream* s;  // The Stream to hand to AQIMgr
+  PMS5003Array sensors{NSensors};
+
+  SecondarySerial();
+
+  void begin();
+
+  // Moves received bytes through the parsers. Call frequently.
+  void loop();
+
+  // The combined readings go to the handler rather than straight to AQIMgr.
+  // A handler that wants AQIMgr to see something calls present() itself.
+  void setFrameHandler(FrameHandler handler) { sensors.setFrameHandler(handler); }
+  void present(const AQIReadings& r) { links[0].present(r); }
+
+  // How often readings are wanted, in ms. Decides whether the sensors are
+  // left running or slept between samples.
+  void setSampleInterval(uint32_t ms) { duty.setInterval(ms); }
+  PMS5003DutyCycle::State dutyState() const { return duty.state(); }
+
+  // Called when a duty-cycled sample has been taken and no more frames are
+  // coming until the next one
+  void setSampleEndHandler(PMS5003DutyCycle::SampleEndHandler handler) {
+    duty.setSampleEndHandler(handler);
   }
 
+  // A bit for each sensor that is drifting, or stale while it should be
+  // sending frames
+  uint8_t faults(uint32_t now) const;
+
+  // Frames per second accepted from sensor i over the last RateWindow
+  float frameRate(uint8_t i) const { return rates[i]; }
+
+  // ms since sensor i's last frame, or UINT32_MAX if it has never sent one
+  uint32_t frameAge(uint8_t i, uint32_t now) const;
+
+  // Totals for all of the sensors, or the stats for sensor i
+  Stats stats() const;
+  Stats stats(uint8_t i) const { return links[i].stats(); }
+
 private:
-  const uint16_t SensorBaudRate = 9600;
-};
+  static constexpr uint32_t SensorBaudRate = 9600;
+  static constexpr size_t DriverBufferSize = 512;   // ~16 frames
+  static constexpr uint32_t RateWindow = 10 * 1000L;
 
+  PMS5003Link links[NSensors];
+  Stream* devices[NSensors] = {};
+  PMS5003DutyCycle duty;
+  uint32_t rateStart = 0;
+  uint32_t rateFrames[NSensors] = {};
+  float rates[NSensors] = {};
+};
 
-#endif  // SecondarySerial_h
\ No newline at end of file
+#endif  // SecondarySerial_h
@@ -0,0 +1,195 @@
+/*
+ * WeatherSampler
+ *    Samples the configured weather sensors without blocking the loop
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Hardware Definitions
+#include "HWConfig.h"
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+#if defined(BME280_READINGS)
+  #include <Adafruit_BME280.h>
+#endif
+#if defined(DHT22_READINGS)
+  #include <DHT.h>
+#endif
+#if defined(DS18B20_READINGS)
+  #include <OneWire.h>
+  #include <DallasTemperature.h>
+#endif
+//                                  Local Includes
+#include "WeatherSampler.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+#if defined(BME280_READINGS)
+  Adafruit_BME280 bme;
+  bool bmeFound = false;
+#endif
+#if defined(DHT22_READINGS)
+  DHT dht(DHT22_PIN, DHT22);
+#endif
+#if defined(DS18B20_READINGS)
+  OneWire oneWire(DS18B20_PIN);
+  DallasTemperature ds18b20(&oneWire);
+#endif
+}
+
+
+void WeatherSampler::begin(WeatherMgr& mgr) {
+  uint8_t readings = 0;
+
+  #if defined(BME280_READINGS)
+    readings |= BME280_READINGS;
+    if (BME_I2C_ADDR != 0) {
+      bmeFound = bme.begin(BME_I2C_ADDR);
+      if (bmeFound) {
+        bme.setSampling(
+          Adafruit_BME280::MODE_NORMAL,
+          Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1, Adafruit_BME280::SAMPLING_X1,
+          Adafruit_BME280::FILTER_OFF, Adafruit_BME280::STANDBY_MS_1000);
+      } else {
+        Log.warning(F("WeatherSampler: no BME280 found at 0x%x"), BME_I2C_ADDR);
+      }
+    }
+  #endif
+
+  #if defined(DHT22_READINGS)
+    readings |= DHT22_READINGS;
+    dht.begin();
+  #endif
+
+  #if defined(DS18B20_READINGS)
+    readings |= DS18B20_READINGS;
+    ds18b20.begin();
+    ds18b20.setWaitForConversion(false);
+  #endif
+
+  sensor.begin(this, readings);
+  mgr.addSensor(&sensor);
+
+  // Complete one sample before WeatherMgr takes its first reading. This is
+  // the only time the sampler waits on the sensors.
+  while (sample.timestamp == 0) { loop(); delay(1); }
+}
+
+void WeatherSampler::loop() {
+  uint32_t now = millis();
+  switch (phase) {
+    case Phase::Idle:
+      if (started && now - cycleStart < SampleInterval) return;
+      started = true;
+      cycleStart = now;
+      pending = Sample();
+      phase = Phase::StartDS18B20;
+      break;
+    case Phase::StartDS18B20:
+      startDS18B20();
+      phase = Phase::ReadBME280;
+      break;
+    case Phase::ReadBME280:
+      readBME280();
+      phase = Phase::ReadDHT22;
+      break;
+    case Phase::ReadDHT22:
+      readDHT22();
+      phase = Phase::CollectDS18B20;
+      break;
+    case Phase::CollectDS18B20:
+      if (!collectDS18B20()) return;  // Still converting
+      pending.timestamp = millis();
+      sample = pending;
+      phase = Phase::Idle;
+      break;
+  }
+}
+
+bool WeatherSampler::has(Device d) {
+  switch (d) {
+    #if defined(BME280_READINGS)
+      case BMEDevice: return true;
+    #endif
+    #if defined(DHT22_READINGS)
+      case DHTDevice: return true;
+    #endif
+    #if defined(DS18B20_READINGS)
+      case DSDevice: return true;
+    #endif
+    default: return false;
+  }
+}
+
+void WeatherSampler::record(Device d, uint32_t duration, bool ok) {
+  Health& h = _health[d];
+  h.reads++;
+  if (!ok) h.failures++;
+  h.lastMicros = duration;
+  if (duration > h.maxMicros) h.maxMicros = duration;
+}
+
+void WeatherSampler::startDS18B20() {
+  #if defined(DS18B20_READINGS)
+    uint32_t start = micros();
+    ds18b20.requestTemperatures();
+    conversionDone = millis() + ds18b20.millisToWaitForConversion(ds18b20.getResolution());
+    dsMicros = micros() - start;
+  #endif
+}
+
+void WeatherSampler::readBME280() {
+  #if defined(BME280_READINGS)
+    uint32_t start = micros();
+    float temp, humi, pressure;
+    if (BME_I2C_ADDR == 0) {
+      // Mocked: a temperature that drifts slowly so charts have some shape
+      temp = 21.0 + ((millis() / (60 * 1000L)) % 20) * 0.1;
+      humi = 45.0;
+      pressure = 1013.25;
+    } else if (bmeFound) {
+      temp = bme.readTemperature();
+      humi = bme.readHumidity();
+      pressure = bme.readPressure() / 100.0;
+    } else { record(BMEDevice, 0, false); return; }
+    record(BMEDevice, micros() - start, !isnan(temp) && !isnan(humi) && !isnan(pressure));
+    if (BME280_READINGS & READ_TEMP) pending.temp = temp;
+    if (BME280_READINGS & READ_HUMI) pending.humi = humi;
+    if (BME280_READINGS & READ_PRES) pending.pressure = pressure;
+  #endif
+}
+
+void WeatherSampler::readDHT22() {
+  #if defined(DHT22_READINGS)
+    // The first call does the (blocking) transfer; the second uses its result
+    uint32_t start = micros();
+    float temp = dht.readTemperature();
+    float humi = dht.readHumidity();
+    record(DHTDevice, micros() - start, !isnan(temp) && !isnan(humi));
+    if (DHT22_READINGS & READ_TEMP) pending.temp = temp;
+    if (DHT22_READINGS & READ_HUMI) pending.humi = humi;
+  #endif
+}
+
+// Returns false if the conversion hasn't finished yet
+bool WeatherSampler::collectDS18B20() {
+  #if defined(DS18B20_READINGS)
+    if ((int32_t)(millis() - conversionDone) < 0) return false;
+    uint32_t start = micros();
+    float temp = ds18b20.getTempCByIndex(0);
+    record(DSDevice, dsMicros + (micros() - start), temp != DEVICE_DISCONNECTED_C);
+    if (temp != DEVICE_DISCONNECTED_C && (DS18B20_READINGS & READ_TEMP)) pending.temp = temp;
+  #endif
+  return true;
+}
+
+void WeatherSampler::SampledSensor::takeReadings(WeatherReadings& readings) {
+  const Sample& s = sampler->latest();
+  const Calibration* cal = sampler->calibration;
+  if (_availableReadingTypes & READ_TEMP) readings.temp = cal ? cal->apply(Calibration::Temp, s.temp) : s.temp;
+  if (_availableReadingTypes & READ_HUMI) readings.humidity = cal ? cal->apply(Calibration::Humi, s.humi) : s.humi;
+  if (_availableReadingTypes & READ_PRES) readings.pressure = cal ? cal->apply(Calibration::Pressure, s.pressure) : s.pressure;
+}
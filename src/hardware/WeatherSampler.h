@@ -0,0 +1,119 @@
+/*
+ * WeatherSampler
+ *    Samples the configured weather sensors without blocking the loop
+ *
+ * NOTES:
+ * o WeatherMgr reads its sensors synchronously when takeReadings() is
+ *   called. A DS18B20 conversion takes up to 750ms and a DHT22 is bit-banged
+ *   with interrupts off, so the AQI serial stream, buttons, and web server
+ *   used to stall behind every weather reading.
+ * o Instead, the sensors listed in SensorConfig.h (BME280_READINGS,
+ *   DHT22_READINGS, DS18B20_READINGS) are driven by a state machine that
+ *   does one short step per call to loop(): start a DS18B20 conversion,
+ *   read the BME280, read the DHT22, then collect the DS18B20 result once
+ *   the conversion time has passed. No step waits on a sensor.
+ * o WeatherMgr is given a single WeatherSensor that returns the most
+ *   recent sample, calibrated, so its takeReadings() no longer touches the hardware and
+ *   everything built on WeatherMgr (history, AIO, screens) is unchanged.
+ * o The BME280 runs in normal mode, measuring continuously on its own, so
+ *   reading it is just a register transfer.
+ * o The DHT22 protocol can't be split up; its read still takes ~5ms with
+ *   interrupts off. It is done in a pass of its own, at most once per
+ *   SampleInterval, rather than alongside the other sensors.
+ * o A BME_I2C_ADDR of 0 means the BME280 is mocked.
+ * o For each sensor the number of reads, failed reads (no device, or NaN
+ *   or disconnected values), and the time spent in the latest and longest
+ *   read are kept in health(). For the DS18B20 the time is that of starting
+ *   and collecting the conversion, not the wait in between.
+ * o begin() takes the first sample synchronously, during startup, so that
+ *   WeatherMgr's first reading has values.
+ *
+ */
+
+#ifndef WeatherSampler_h
+#define WeatherSampler_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  WebThing Includes
+#include <sensors/WeatherMgr.h>
+#include <sensors/WeatherSensor.h>
+//                                  Local Includes
+#include "HWConfig.h"
+#include "../data/Calibration.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class WeatherSampler {
+public:
+  static constexpr uint32_t SampleInterval = 10 * 1000L;   // ms
+
+  struct Sample {
+    float temp = NAN;       // Celsius, uncorrected
+    float humi = NAN;       // Percent, uncorrected
+    float pressure = NAN;   // hPa
+    uint32_t timestamp = 0; // millis() when the sample was completed
+  };
+
+  enum Device : uint8_t { BMEDevice, DHTDevice, DSDevice, NDevices };
+
+  struct Health {
+    uint32_t reads;
+    uint32_t failures;
+    uint32_t lastMicros;    // Duration of the latest read
+    uint32_t maxMicros;     // Duration of the longest read
+  };
+
+  // Initializes the sensors and registers a WeatherSensor with mgr that
+  // reports the latest sample. Call in place of
+  // WeatherUtils::configureAvailableSensors().
+  void begin(WeatherMgr& mgr);
+
+  // Corrections to apply to the readings WeatherMgr takes. The samples
+  // themselves stay uncorrected.
+  void setCalibration(const Calibration* c) { calibration = c; }
+
+  // Performs at most one sampling step. Call frequently.
+  void loop();
+
+  const Sample& latest() const { return sample; }
+
+  // Whether the device is configured, and how its reads have gone
+  static bool has(Device d);
+  const Health& health(Device d) const { return _health[d]; }
+
+private:
+  enum class Phase : uint8_t { Idle, StartDS18B20, ReadBME280, ReadDHT22, CollectDS18B20 };
+
+  // The WeatherSensor that WeatherMgr reads
+  class SampledSensor : public WeatherSensor {
+  public:
+    void begin(const WeatherSampler* s, uint8_t readings) {
+      sampler = s;
+      _availableReadingTypes = readings;
+    }
+    virtual void takeReadings(WeatherReadings& readings) override;
+  private:
+    const WeatherSampler* sampler = nullptr;
+  };
+
+  SampledSensor sensor;
+  const Calibration* calibration = nullptr;
+  Sample sample;
+  Sample pending;
+  Phase phase = Phase::Idle;
+  uint32_t cycleStart = 0;
+  uint32_t conversionDone = 0;
+  bool started = false;
+  uint32_t dsMicros = 0;        // Time spent starting the DS18B20 conversion
+  Health _health[NDevices] = {};
+
+  void startDS18B20();
+  void readBME280();
+  void readDHT22();
+  bool collectDS18B20();
+  void record(Device d, uint32_t micros, bool ok);
+};
+
+#endif  // WeatherSampler_h
@@ -0,0 +1,375 @@
+/*
+ * ColumnStore
+ *    A compressed store for rows of timestamped 16-bit values
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <string.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "ColumnStore.h"
+#include "../util/VarInt.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  // Writes bits most significant first. With no buffer it only counts them,
+  // which is how the size of a row is found before it is stored.
+  struct BitWriter {
+    uint8_t* buf;
+    uint32_t pos;
+
+    void put(uint32_t v, uint8_t n) {
+      if (!buf) { pos += n; return; }
+      while (n) {
+        uint8_t room = 8 - (pos & 7);
+        uint8_t take = n < room ? n : room;
+        uint8_t chunk = (v >> (n - take)) & ((1u << take) - 1);
+        uint8_t& b = buf[pos >> 3];
+        if (room == 8) b = 0;
+        b |= chunk << (room - take);
+        pos += take;
+        n -= take;
+      }
+    }
+  };
+
+  struct BitReader {
+    const uint8_t* buf;
+    uint32_t pos;
+
+    uint32_t get(uint8_t n) {
+      uint32_t v = 0;
+      while (n) {
+        uint8_t room = 8 - (pos & 7);
+        uint8_t take = n < room ? n : room;
+        v = (v << take) | ((buf[pos >> 3] >> (room - take)) & ((1u << take) - 1));
+        pos += take;
+        n -= take;
+      }
+      return v;
+    }
+  };
+
+  bool fits(int32_t d, uint8_t bits) {
+    int32_t limit = 1 << (bits - 1);
+    return d >= -limit && d < limit;
+  }
+
+  constexpr uint8_t Escape = 16;    // Unary length at which a change is written whole
+  constexpr uint8_t KBits = 4;      // Rice parameters are 0..14
+  constexpr uint8_t PrefixCode = 15;  // In place of k, selects the prefix code
+
+  // Widths of the zigzag encoded changes that follow prefixes 10, 110,
+  // 1110, and 11110 in the prefix code. Prefix 11111 is followed by all
+  // 16 bits.
+  constexpr uint8_t Widths[] = {3, 5, 8, 12};
+  constexpr uint8_t NWidths = sizeof(Widths);
+
+  uint16_t zigzag(int16_t d) { return VarInt::zigzag(d); }
+
+  // The number of bits the prefix code uses for d
+  uint8_t prefixBits(int16_t d) {
+    if (d == 0) return 1;
+    uint8_t prefix = 1;
+    for (uint8_t width : Widths) {
+      if (fits(d, width)) return prefix + 1 + width;
+      prefix++;
+    }
+    return prefix + 16;
+  }
+
+  // Writes a change to a value, Rice coded with parameter k or, if k is
+  // PrefixCode, in the prefix code
+  void putChange(BitWriter& w, int16_t d, uint8_t k) {
+    if (k == PrefixCode) {
+      if (d == 0) { w.put(0, 1); return; }
+      uint8_t prefix = 1;     // Number of 1 bits before the terminating 0
+      for (uint8_t width : Widths) {
+        if (fits(d, width)) {
+          w.put(((1 << prefix) - 1) << 1, prefix + 1);
+          w.put(zigzag(d), width);
+          return;
+        }
+        prefix++;
+      }
+      w.put((1 << prefix) - 1, prefix);
+      w.put((uint16_t)d, 16);
+      return;
+    }
+
+    uint16_t z = zigzag(d);
+    uint16_t q = z >> k;
+    if (q < Escape) {
+      w.put(((1u << q) - 1) << 1, q + 1);
+      w.put(z & ((1u << k) - 1), k);
+    } else {
+      w.put((1u << Escape) - 1, Escape);
+      w.put(z, 16);
+    }
+  }
+
+  int16_t getChange(BitReader& r, uint8_t k) {
+    if (k == PrefixCode) {
+      uint8_t prefix = 0;
+      while (prefix <= NWidths && r.get(1)) prefix++;
+      if (prefix == 0) return 0;
+      if (prefix <= NWidths) return VarInt::unzigzag(r.get(Widths[prefix - 1]));
+      return (int16_t)r.get(16);
+    }
+
+    uint8_t q = 0;
+    while (q < Escape && r.get(1)) q++;
+    if (q == Escape) return VarInt::unzigzag(r.get(16));
+    return VarInt::unzigzag(((uint32_t)q << k) | r.get(k));
+  }
+
+  // The code for n changes whose zigzag encodings sum to sum and which take
+  // prefixSum bits in the prefix code: the Rice parameter that codes them
+  // in about the fewest bits (each costs k + 1 bits plus its value shifted
+  // right by k) or, if that is no better, PrefixCode. Sets bits to the
+  // estimated cost.
+  uint8_t chooseCode(uint32_t sum, uint16_t prefixSum, uint32_t n, uint32_t& bits) {
+    uint8_t best = PrefixCode;
+    bits = prefixSum;
+    for (uint8_t k = 0; k < PrefixCode; k++) {
+      uint32_t cost = n * (k + 1) + (sum >> k);
+      if (cost < bits) { best = k; bits = cost; }
+    }
+    return best;
+  }
+}
+
+void ColumnStore::begin(
+    uint8_t nChannels, uint32_t unit, uint8_t* buf, uint16_t blockSize, uint8_t nBlocks)
+{
+  this->nChannels = nChannels < MaxChannels ? nChannels : MaxChannels;
+  this->unit = unit ? unit : 1;
+  this->buf = buf;
+  this->blockSize = blockSize;
+  this->nBlocks = nBlocks;
+  clear();
+}
+
+void ColumnStore::clear() {
+  head = used = 0;
+  rows = 0;
+  memset(&last, 0, sizeof(last));
+  spacing = 0;
+  modes = 0;
+  memset(k, 0, sizeof(k));
+  memset(change, 0, sizeof(change));
+  memset(sums, 0, sizeof(sums));
+  memset(prefixSums, 0, sizeof(prefixSums));
+}
+
+ColumnStore::Header ColumnStore::header(const uint8_t* block) {
+  Header h;
+  memcpy(&h, block, sizeof(h));
+  return h;
+}
+
+void ColumnStore::setHeader(uint8_t* block, const Header& h) {
+  memcpy(block, &h, sizeof(h));
+}
+
+// Encodes row against the newest row, starting at the given bit of payload.
+// Returns the bit following the row. A null payload only measures the row.
+uint32_t ColumnStore::encode(const Row& row, uint8_t* payload, uint32_t bit) const {
+  BitWriter w = {payload, bit};
+
+  int32_t s = (row.ts - last.ts) / unit;
+  int32_t dod = s - spacing;
+  if (dod == 0) w.put(0, 1);
+  else if (fits(dod, 7)) { w.put(0x2, 2); w.put(VarInt::zigzag(dod), 7); }
+  else { w.put(0x3, 2); w.put(s, 32); }
+
+  for (uint8_t c = 0; c < nChannels; c++) {
+    int16_t d = row.v[c] - last.v[c];
+    if (modes & (1 << c)) d -= change[c];
+    putChange(w, d, k[c]);
+  }
+  return w.pos;
+}
+
+// Sums the changes in each channel of row as a delta and as a delta of
+// deltas, and their cost in the prefix code, so the next block can choose
+// the cheapest mode and code
+void ColumnStore::track(const Row& row) {
+  for (uint8_t c = 0; c < nChannels; c++) {
+    int16_t d = row.v[c] - last.v[c];
+    sums[c][0] += zigzag(d);
+    sums[c][1] += zigzag(d - change[c]);
+    prefixSums[c][0] += prefixBits(d);
+    prefixSums[c][1] += prefixBits(d - change[c]);
+    change[c] = d;
+  }
+}
+
+// Starts a new block with row as its anchor, dropping the oldest block if
+// they are all in use. Each channel's mode and code are chosen from its
+// changes in the previous block.
+void ColumnStore::startBlock(const Row& row) {
+  uint32_t changes = used ? header(blockAt(used - 1)).rows - 1 : 0;
+  if (used == nBlocks) {
+    rows -= header(blockAt(0)).rows;
+    head = (head + 1) % nBlocks;
+    used--;
+  }
+
+  modes = 0;
+  for (uint8_t c = 0; c < nChannels; c++) {
+    uint32_t bits[2];
+    uint8_t code[2];
+    for (uint8_t m = 0; m < 2; m++) code[m] = chooseCode(sums[c][m], prefixSums[c][m], changes, bits[m]);
+    uint8_t mode = bits[1] < bits[0] ? 1 : 0;
+    modes |= mode << c;
+    k[c] = code[mode];
+    sums[c][0] = sums[c][1] = 0;
+    prefixSums[c][0] = prefixSums[c][1] = 0;
+    change[c] = 0;
+  }
+
+  uint8_t* block = blockAt(used++);
+  BitWriter w = {block + HeaderSize, 0};
+  for (uint8_t c = 0; c < nChannels; c++) {
+    w.put((modes >> c) & 1, 1);
+    w.put(k[c], KBits);
+  }
+  for (uint8_t c = 0; c < nChannels; c++) w.put(row.v[c], 16);
+  setHeader(block, {row.ts, 1, (uint16_t)w.pos});
+  spacing = 1;
+}
+
+bool ColumnStore::append(const Row& row) {
+  if (rows && row.ts <= last.ts) return false;
+
+  uint32_t capacity = (uint32_t)(blockSize - HeaderSize) * 8;
+  uint8_t* block = used ? blockAt(used - 1) : nullptr;
+  Header h = block ? header(block) : Header{0, 0, 0};
+  uint32_t end = block ? encode(row, nullptr, h.bits) : 0;
+
+  if (!block || end > capacity) {
+    startBlock(row);
+  } else {
+    encode(row, block + HeaderSize, h.bits);
+    track(row);
+    spacing = (row.ts - last.ts) / unit;
+    h.rows++;
+    h.bits = end;
+    setHeader(block, h);
+  }
+  last = row;
+  rows++;
+  return true;
+}
+
+ColumnStore::Cursor ColumnStore::rowsAfter(uint32_t after) const {
+  Cursor c;
+  c.store = this;
+  c.after = after;
+  // Start with the newest block that starts no later than after; every
+  // block before it holds only older rows
+  uint8_t lo = 0, hi = used ? used - 1 : 0;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi + 1) / 2;
+    if (header(blockAt(mid)).firstTs <= after) lo = mid;
+    else hi = mid - 1;
+  }
+  c.block = lo;
+  return c;
+}
+
+size_t ColumnStore::bytesUsed() const {
+  size_t total = 0;
+  for (uint8_t i = 0; i < used; i++) total += HeaderSize + (header(blockAt(i)).bits + 7) / 8;
+  return total;
+}
+
+namespace {
+  // Written ahead of a saved store so that load() can tell whether it fits
+  struct Geometry {
+    uint8_t nChannels;
+    uint8_t nBlocks;
+    uint16_t blockSize;
+    uint32_t unit;
+  };
+}
+
+bool ColumnStore::save(WriteFn write) const {
+  Geometry g = {nChannels, nBlocks, blockSize, unit};
+  if (!write(&g, sizeof(g)) || !write(&used, sizeof(used)) || !write(&rows, sizeof(rows)) ||
+      !write(&last, sizeof(last)) || !write(&spacing, sizeof(spacing)) ||
+      !write(&modes, sizeof(modes)) || !write(k, sizeof(k)) ||
+      !write(change, sizeof(change)) || !write(sums, sizeof(sums)) ||
+      !write(prefixSums, sizeof(prefixSums))) {
+    return false;
+  }
+  // Oldest first, so that load() can place them from the start of buf
+  for (uint8_t i = 0; i < used; i++) {
+    if (!write(blockAt(i), blockSize)) return false;
+  }
+  return true;
+}
+
+bool ColumnStore::load(ReadFn read) {
+  clear();
+  Geometry g;
+  uint8_t n;
+  bool ok = read(&g, sizeof(g)) &&
+      g.nChannels == nChannels && g.nBlocks == nBlocks &&
+      g.blockSize == blockSize && g.unit == unit &&
+      read(&n, sizeof(n)) && n <= nBlocks && read(&rows, sizeof(rows)) &&
+      read(&last, sizeof(last)) && read(&spacing, sizeof(spacing)) &&
+      read(&modes, sizeof(modes)) && read(k, sizeof(k)) &&
+      read(change, sizeof(change)) && read(sums, sizeof(sums)) &&
+      read(prefixSums, sizeof(prefixSums));
+  for (uint8_t i = 0; ok && i < n; i++) ok = read(buf + i * blockSize, blockSize);
+  if (!ok) { clear(); return false; }
+  used = n;
+  return true;
+}
+
+bool ColumnStore::Cursor::next(Row& row) {
+  for (;;) {
+    BitReader r;
+    if (left == 0) {
+      if (!store || block >= store->used) return false;
+      const uint8_t* data = store->blockAt(block++);
+      Header h = header(data);
+      r = {data + HeaderSize, 0};
+      modes = 0;
+      for (uint8_t c = 0; c < store->nChannels; c++) {
+        modes |= r.get(1) << c;
+        k[c] = r.get(KBits);
+      }
+      row.ts = h.firstTs;
+      for (uint8_t c = 0; c < store->nChannels; c++) {
+        row.v[c] = r.get(16);
+        change[c] = 0;
+      }
+      left = h.rows - 1;
+      spacing = 1;
+    } else {
+      r = {store->blockAt(block - 1) + HeaderSize, bit};
+      if (r.get(1)) {
+        if (r.get(1) == 0) spacing += VarInt::unzigzag(r.get(7));
+        else spacing = r.get(32);
+      }
+      row.ts = prev.ts + spacing * store->unit;
+
+      for (uint8_t c = 0; c < store->nChannels; c++) {
+        int16_t d = getChange(r, k[c]);
+        if (modes & (1 << c)) d += change[c];
+        row.v[c] = prev.v[c] + d;
+        change[c] = d;
+      }
+      left--;
+    }
+    bit = r.pos;
+    prev = row;
+    if (row.ts > after) return true;
+  }
+}
@@ -0,0 +1,171 @@
+/*
+ * ColumnStore
+ *    A compressed store for rows of timestamped 16-bit values, in the style
+ *    of the Gorilla time series encoding
+ *
+ * NOTES:
+ * o Each row has a timestamp and up to MaxChannels values. Each channel is
+ *   encoded against its own previous value, so a channel that changes
+ *   slowly costs a bit or a few per row no matter what the others do.
+ * o Timestamps are delta-of-delta encoded in units of unit seconds (every
+ *   timestamp must be a multiple of unit). Rows that arrive at a steady
+ *   pace cost one bit:
+ *      0                       same spacing as the previous row
+ *      10 + 7 bits             spacing changed by -64..63 units (zigzag)
+ *      11 + 32 bits            the spacing in units
+ * o Values are encoded as a change: either the change from the channel's
+ *   previous value (delta) or the change in that change (delta of delta).
+ *   Noisy channels do best with deltas and steadily trending ones (e.g.
+ *   temperature over the course of a day) with deltas of deltas.
+ * o Changes are zigzag encoded and then, for most channels, Rice coded with
+ *   a parameter k: the value shifted right by k is written in unary (that
+ *   many 1s and a 0) followed by its low k bits. A channel with k = 0
+ *   costs one bit per row while it doesn't change, and a noisy channel
+ *   with a larger k pays about k + 2 bits for changes up to 2^k. A change
+ *   whose unary part would be Escape bits or longer is written as Escape
+ *   1s and then all 16 bits.
+ * o Rice codes suit changes of a steady size. A channel that is mostly
+ *   still but sometimes jumps (e.g. the AQI of daily samples through a
+ *   smoke event) does better with a prefix code whose length grows with
+ *   the size of the change:
+ *      0                       no change
+ *      10 + 3 bits             -4..3 (zigzag)
+ *      110 + 5 bits            -16..15 (zigzag)
+ *      1110 + 8 bits           -128..127 (zigzag)
+ *      11110 + 12 bits         -2048..2047 (zigzag)
+ *      11111 + 16 bits         any change, modulo 2^16
+ * o While a block is filled, each channel's changes are tracked in both
+ *   modes: the sum of their zigzag encodings, from which the best k and its
+ *   cost are estimated, and their cost in the prefix code. The next block
+ *   uses the cheapest mode and code. The first block has nothing to go on
+ *   and uses deltas in the prefix code.
+ * o Missing values are stored as whatever sentinel the caller uses; a run
+ *   of them costs one bit per row.
+ * o The buffer is divided into fixed-size blocks. A block starts with a
+ *   header, each channel's mode and code, and an anchor row whose values are
+ *   stored whole, so each block can be decoded on its own. Larger blocks
+ *   spread that cost over more rows, but drop more rows at a time. When every block is
+ *   full the oldest one is dropped, so the store always holds the newest
+ *   rows that fit.
+ * o Rows are only ever read with a Cursor, which decodes them oldest first.
+ *   Blocks are in time order, so the first block that can hold the
+ *   requested time is found with a binary search of their headers; older
+ *   blocks are never decoded.
+ * o save() and load() copy a store's blocks and state out and back in, so
+ *   that a store can be kept in flash. The caller supplies the I/O.
+ * o There are no Arduino dependencies so this may also be used in host
+ *   builds. See tools/bench/HistoryCodecBench.cpp.
+ *
+ */
+
+#ifndef ColumnStore_h
+#define ColumnStore_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class ColumnStore {
+public:
+  static constexpr uint8_t MaxChannels = 16;
+  static constexpr uint16_t HeaderSize = 8;     // Bytes at the start of every block
+
+  struct Row {
+    uint32_t ts;
+    uint16_t v[MaxChannels];
+  };
+
+  class Cursor {
+  public:
+    // Decodes the next row. Returns false when there are none left.
+    bool next(Row& row);
+
+  private:
+    friend class ColumnStore;
+
+    const ColumnStore* store = nullptr;
+    uint32_t after = 0;     // Only rows newer than this are returned
+    uint8_t block = 0;      // Blocks visited, counting from the oldest
+    uint16_t left = 0;      // Rows left to decode in the current block
+    uint32_t bit = 0;       // Position in the current block's payload
+    int32_t spacing = 0;    // In units
+    uint16_t modes = 0;     // A bit for each channel encoded as delta of delta
+    uint8_t k[MaxChannels];
+    int16_t change[MaxChannels];
+    Row prev;
+  };
+
+  // buf is nBlocks * blockSize bytes, and must outlive the store. unit is
+  // the granularity of the timestamps, in seconds.
+  void begin(uint8_t nChannels, uint32_t unit, uint8_t* buf, uint16_t blockSize, uint8_t nBlocks);
+
+  // Appends a row. Returns false, and stores nothing, if the row is not
+  // newer than the newest row.
+  bool append(const Row& row);
+
+  // A Cursor over the rows whose timestamp is greater than after
+  Cursor rowsAfter(uint32_t after) const;
+
+  // The timestamp of the oldest row. Only meaningful if size() > 0.
+  uint32_t oldestTs() const { return used ? header(blockAt(0)).firstTs : 0; }
+
+  // The newest row. Only meaningful if size() > 0.
+  const Row& newest() const { return last; }
+
+  uint32_t size() const { return rows; }
+  size_t bytesUsed() const;
+
+  // Drops every row
+  void clear();
+
+  // Each returns false if the data couldn't be written or read in full
+  using WriteFn = std::function<bool(const void* data, size_t size)>;
+  using ReadFn = std::function<bool(void* data, size_t size)>;
+
+  // Writes the rows and the state needed to keep appending to them
+  bool save(WriteFn write) const;
+
+  // Reads what save() wrote, replacing the rows. The store must have been
+  // begun with the same channels, unit, and blocks. Returns false, leaving
+  // the store empty, if it wasn't or the data is incomplete.
+  bool load(ReadFn read);
+
+private:
+  uint8_t nChannels = 0;
+  uint32_t unit = 1;
+  uint8_t* buf = nullptr;
+  uint16_t blockSize = 0;
+  uint8_t nBlocks = 0;
+
+  uint8_t head = 0;         // Index of the oldest block
+  uint8_t used = 0;         // Number of blocks holding rows
+  uint32_t rows = 0;
+  Row last;                 // The newest row
+  int32_t spacing = 0;      // Between the two newest rows, in units
+  uint16_t modes = 0;       // Of the newest block
+  uint8_t k[MaxChannels];   // Of the newest block: Rice parameters, or PrefixCode
+  int16_t change[MaxChannels];      // Between the two newest rows
+  uint32_t sums[MaxChannels][2];    // Zigzag changes as delta, delta of delta, this block
+  uint16_t prefixSums[MaxChannels][2];  // Their cost, in bits, in the prefix code
+
+  struct Header {
+    uint32_t firstTs;
+    uint16_t rows;
+    uint16_t bits;          // Bits of payload in use
+  };
+
+  uint8_t* blockAt(uint8_t i) const { return buf + ((head + i) % nBlocks) * blockSize; }
+  static Header header(const uint8_t* block);
+  static void setHeader(uint8_t* block, const Header& h);
+  uint32_t encode(const Row& row, uint8_t* payload, uint32_t bit) const;
+  void track(const Row& row);
+  void startBlock(const Row& row);
+};
+
+#endif  // ColumnStore_h
@@ -0,0 +1,81 @@
+/*
+ * Downsampler
+ *    Reduces the samples of a History range within a time window to a
+ *    given number of points using Largest-Triangle-Three-Buckets
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "Downsampler.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+Downsampler::Downsampler(
+    const History& history, History::Range r, uint32_t start, uint32_t end,
+    uint16_t points, ValueFn value)
+  : start(start), period(history.period(r)), points(points),
+    trail(history, r, start, end, value), lead(history, r, start, end, value)
+{
+  Window counter(history, r, start, end, value);
+  History::Sample s;
+  int32_t v;
+  while (counter.next(s, v)) n++;
+  if (points < 3) this->points = n;   // No downsampling
+}
+
+bool Downsampler::Window::next(History::Sample& s, int32_t& v) {
+  while (c.next(s)) {
+    if (s.ts > end) return false;
+    if (value(s, v)) { index++; return true; }
+  }
+  return false;
+}
+
+// The index of the first sample of a bucket. The first and last samples are
+// buckets of their own, and bucket 0 is the one after the first sample.
+uint32_t Downsampler::bound(uint32_t bucket) const {
+  if (bucket >= (uint32_t)points - 1) return n;
+  return 1 + (uint64_t)bucket * (n - 2) / (points - 2);
+}
+
+bool Downsampler::next(History::Sample& s) {
+  int32_t v;
+  if (n <= points) return trail.next(s, v);
+  if (emitted >= points) return false;
+
+  if (emitted == 0 || emitted == (uint32_t)points - 1) {
+    if (!trail.next(s, v)) return false;
+  } else {
+    choose(s, v, emitted - 1);
+  }
+  ax = x(s);
+  ay = v;
+  emitted++;
+  return true;
+}
+
+// Chooses the sample of the bucket that makes the largest triangle with the
+// previous point and the average of the next bucket
+void Downsampler::choose(History::Sample& s, int32_t& v, uint32_t bucket) {
+  History::Sample candidate;
+  int32_t cv;
+
+  uint32_t next = bound(bucket + 1), after = bound(bucket + 2);
+  while (lead.index < next && lead.next(candidate, cv)) { }
+  float cx = 0, cy = 0;
+  uint32_t m = 0;
+  while (lead.index < after && lead.next(candidate, cv)) {
+    cx += x(candidate); cy += cv; m++;
+  }
+  if (m) { cx /= m; cy /= m; }
+
+  float best = -1;
+  while (trail.index < next && trail.next(candidate, cv)) {
+    float area = fabsf((ax - cx) * (cv - ay) - (ax - x(candidate)) * (cy - ay));
+    if (area > best) { best = area; s = candidate; v = cv; }
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ * Downsampler
+ *    Reduces the samples of a History range within a time window to a
+ *    given number of points using Largest-Triangle-Three-Buckets
+ *
+ * NOTES:
+ * o A chart a few hundred pixels wide can't show more points than it has
+ *   pixels, so there is no point sending it a week of 15 minute samples.
+ *   LTTB keeps the first and last samples and divides the rest into
+ *   buckets, one per remaining point. From each bucket it keeps the sample
+ *   that forms the largest triangle with the point kept from the previous
+ *   bucket and the average of the next bucket. That preserves the peaks
+ *   and troughs that simply averaging or striding would flatten.
+ * o Points are chosen on one value of each sample (e.g. the AQI), given by
+ *   a ValueFn. Samples without that value are ignored. The samples that
+ *   are returned are whole, with all of their values.
+ * o Nothing is buffered: one Cursor walks the current bucket while a
+ *   second runs a bucket ahead to average the next one, and a first pass
+ *   counts the samples in the window. Each sample is decoded at most three
+ *   times, which is cheap, and memory use doesn't depend on the window.
+ * o If the window holds no more samples than points (or points is less
+ *   than 3) every sample is returned.
+ * o There are no Arduino dependencies so this may also be used in host
+ *   builds.
+ *
+ */
+
+#ifndef Downsampler_h
+#define Downsampler_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "History.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class Downsampler {
+public:
+  // Sets v to the value points are chosen on. Returns false if the sample
+  // doesn't have it.
+  using ValueFn = bool (*)(const History::Sample& s, int32_t& v);
+
+  // Covers the samples of range r whose timestamps are in [start, end]
+  Downsampler(
+      const History& history, History::Range r, uint32_t start, uint32_t end,
+      uint16_t points, ValueFn value);
+
+  // The next chosen sample, oldest first. Returns false when there are none
+  // left.
+  bool next(History::Sample& s);
+
+  // The number of samples next() will return in all
+  uint32_t size() const { return (n > points) ? points : n; }
+
+private:
+  // A Cursor that only returns samples in the window that have the value
+  class Window {
+  public:
+    Window(const History& history, History::Range r, uint32_t start, uint32_t end, ValueFn value)
+        : c(history.samplesFrom(r, start)), end(end), value(value) { }
+    bool next(History::Sample& s, int32_t& v);
+    uint32_t index = 0;     // Of the sample next() will return
+  private:
+    History::Cursor c;
+    uint32_t end;
+    ValueFn value;
+  };
+
+  uint32_t start;
+  uint32_t period;
+  uint16_t points;
+  uint32_t n = 0;           // Samples in the window
+  uint32_t emitted = 0;
+  Window trail;             // Walks the bucket being chosen from
+  Window lead;              // Walks the next bucket, to average it
+  float ax = 0, ay = 0;     // The point chosen from the previous bucket
+
+  uint32_t bound(uint32_t bucket) const;
+  float x(const History::Sample& s) const { return (float)(s.ts - start) / period; }
+  void choose(History::Sample& s, int32_t& v, uint32_t bucket);
+};
+
+#endif  // Downsampler_h
@@ -0,0 +1,333 @@
+/*
+ * History
+ *    Keeps hour, day, week, month, and year histories of AQI and weather
+ *    readings
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+#include <string.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "History.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  // The order in which a Sample's values are kept in a ColumnStore row.
+  // Extremes are kept as their distance below and above the average, which
+  // changes far less from sample to sample than the extremes themselves.
+  enum Channel : uint8_t {
+    AQIChannel, NowCastChannel, TempChannel, HumiChannel, PressureChannel,
+    PM25Channel, EpaChannel, AQIBelowChannel, AQIAboveChannel, TempBelowChannel,
+    TempAboveChannel, HumiBelowChannel, HumiAboveChannel, CountChannel, NChannels };
+  static_assert(NChannels <= ColumnStore::MaxChannels, "Too many channels for a ColumnStore");
+
+  void toRow(const History::Sample& s, ColumnStore::Row& row) {
+    row.ts = s.ts;
+    row.v[AQIChannel] = s.aqi;
+    row.v[NowCastChannel] = s.nowCast;
+    row.v[TempChannel] = (uint16_t)s.temp;
+    row.v[HumiChannel] = s.humi;
+    row.v[PressureChannel] = s.pressure;
+    row.v[PM25Channel] = s.pm25;
+    row.v[EpaChannel] = s.pm25Epa;
+    bool aqi = s.aqi != History::NoAQI;
+    bool temp = s.temp != History::NoTemp;
+    bool humi = s.humi != History::NoHumi;
+    row.v[AQIBelowChannel] = aqi ? s.aqi - s.aqiMin : 0;
+    row.v[AQIAboveChannel] = aqi ? s.aqiMax - s.aqi : 0;
+    row.v[TempBelowChannel] = temp ? s.temp - s.tempMin : 0;
+    row.v[TempAboveChannel] = temp ? s.tempMax - s.temp : 0;
+    row.v[HumiBelowChannel] = humi ? s.humi - s.humiMin : 0;
+    row.v[HumiAboveChannel] = humi ? s.humiMax - s.humi : 0;
+    row.v[CountChannel] = s.count;
+  }
+
+  void fromRow(const ColumnStore::Row& row, History::Sample& s) {
+    s.ts = row.ts;
+    s.aqi = row.v[AQIChannel];
+    s.nowCast = row.v[NowCastChannel];
+    s.temp = (int16_t)row.v[TempChannel];
+    s.humi = row.v[HumiChannel];
+    s.pressure = row.v[PressureChannel];
+    s.pm25 = row.v[PM25Channel];
+    s.pm25Epa = row.v[EpaChannel];
+    bool aqi = s.aqi != History::NoAQI;
+    bool temp = s.temp != History::NoTemp;
+    bool humi = s.humi != History::NoHumi;
+    s.aqiMin = aqi ? s.aqi - row.v[AQIBelowChannel] : History::NoAQI;
+    s.aqiMax = aqi ? s.aqi + row.v[AQIAboveChannel] : History::NoAQI;
+    s.tempMin = temp ? s.temp - row.v[TempBelowChannel] : History::NoTemp;
+    s.tempMax = temp ? s.temp + row.v[TempAboveChannel] : History::NoTemp;
+    s.humiMin = humi ? s.humi - row.v[HumiBelowChannel] : History::NoHumi;
+    s.humiMax = humi ? s.humi + row.v[HumiAboveChannel] : History::NoHumi;
+    s.count = row.v[CountChannel];
+  }
+
+  // Widens [lo, hi] to include v, given that n values have been seen so far
+  template <typename T> void extend(T& lo, T& hi, T v, uint16_t n) {
+    if (n == 0 || v < lo) lo = v;
+    if (n == 0 || v > hi) hi = v;
+  }
+
+  template <typename T> T average(int32_t sum, uint16_t n, T none) {
+    return n ? (T)lroundf((float)sum / n) : none;
+  }
+}
+
+History::History() {
+  const uint32_t periods[NRanges] = {60, 5*60, 15*60, 3*60*60, 24*60*60};
+  const uint32_t spans[NRanges] =
+      {60*60, 24*60*60, 7*24*60*60, 30*24*60*60L, 365*24*60*60L};
+  uint8_t* blocks[NRanges] = {hourBlocks, dayBlocks, weekBlocks, monthBlocks, yearBlocks};
+  const uint8_t nBlocks[NRanges] = {HourBlocks, DayBlocks, WeekBlocks, MonthBlocks, YearBlocks};
+
+  for (uint8_t r = 0; r < NRanges; r++) {
+    Tier& t = tiers[r];
+    t.period = periods[r];
+    t.span = spans[r];
+    t.store.begin(NChannels, t.period, blocks[r], BlockSize, nBlocks[r]);
+    t.start = 0;
+    memset(&t.acc, 0, sizeof(t.acc));
+    t.rolled = 0;
+  }
+}
+
+void History::addAQI(uint32_t ts, uint16_t aqi, uint16_t nowCast) {
+  for (uint8_t r = 0; r < NLiveRanges; r++) {
+    if (!advance(r, ts)) continue;
+    Accumulator& a = tiers[r].acc;
+    extend(a.aqiMin, a.aqiMax, aqi, a.aqiCount);
+    a.aqiSum += aqi;
+    a.aqiCount++;
+    if (nowCast != NoAQI) { a.nowCastSum += nowCast; a.nowCastCount++; }
+  }
+}
+
+void History::addWeather(uint32_t ts, float temp, float humi, float pressure) {
+  for (uint8_t r = 0; r < NLiveRanges; r++) {
+    if (!advance(r, ts)) continue;
+    Accumulator& a = tiers[r].acc;
+    if (!isnan(temp)) {
+      int16_t t = lroundf(temp * 10);
+      extend(a.tempMin, a.tempMax, t, a.tempCount);
+      a.tempSum += t; a.tempCount++;
+    }
+    if (!isnan(humi) && humi >= 0) {
+      uint16_t h = lroundf(humi * 10);
+      extend(a.humiMin, a.humiMax, h, a.humiCount);
+      a.humiSum += h; a.humiCount++;
+    }
+    if (!isnan(pressure) && pressure > 0) {
+      a.pressureSum += lroundf(pressure * 10); a.pressureCount++;
+    }
+  }
+}
+
+void History::addPM25(uint32_t ts, uint16_t pm25, uint16_t epa) {
+  for (uint8_t r = 0; r < NLiveRanges; r++) {
+    if (!advance(r, ts)) continue;
+    Accumulator& a = tiers[r].acc;
+    a.pm25Sum += pm25;
+    a.pm25Count++;
+    if (epa != NoPM) { a.epaSum += epa; a.epaCount++; }
+  }
+}
+
+void History::restore(const Sample& s) {
+  uint16_t n = s.count ? s.count : 1;
+  for (uint8_t r = 0; r < NLiveRanges; r++) {
+    if (!advance(r, s.ts)) continue;
+    Accumulator& a = tiers[r].acc;
+    if (s.aqi != NoAQI) {
+      extend(a.aqiMin, a.aqiMax, s.aqiMin, a.aqiCount);
+      extend(a.aqiMin, a.aqiMax, s.aqiMax, 1);
+      a.aqiSum += (uint32_t)s.aqi * n; a.aqiCount += n;
+    }
+    if (s.nowCast != NoAQI) { a.nowCastSum += (uint32_t)s.nowCast * n; a.nowCastCount += n; }
+    if (s.temp != NoTemp) {
+      extend(a.tempMin, a.tempMax, s.tempMin, a.tempCount);
+      extend(a.tempMin, a.tempMax, s.tempMax, 1);
+      a.tempSum += (int32_t)s.temp * n; a.tempCount += n;
+    }
+    if (s.humi != NoHumi) {
+      extend(a.humiMin, a.humiMax, s.humiMin, a.humiCount);
+      extend(a.humiMin, a.humiMax, s.humiMax, 1);
+      a.humiSum += (uint32_t)s.humi * n; a.humiCount += n;
+    }
+    if (s.pm25 != NoPM) { a.pm25Sum += (uint32_t)s.pm25 * n; a.pm25Count += n; }
+    if (s.pm25Epa != NoPM) { a.epaSum += (uint32_t)s.pm25Epa * n; a.epaCount += n; }
+    if (s.pressure != NoPressure) { a.pressureSum += (uint32_t)s.pressure * n; a.pressureCount += n; }
+  }
+}
+
+void History::progress(Progress& p) const {
+  for (uint8_t r = 0; r < NLiveRanges; r++) {
+    p.start[r] = tiers[r].start;
+    p.acc[r] = tiers[r].acc;
+  }
+}
+
+void History::resume(const Progress& p) {
+  for (uint8_t r = 0; r < NLiveRanges; r++) {
+    if (advance(r, p.start[r])) tiers[r].acc = p.acc[r];
+  }
+}
+
+bool History::saveRollups(ColumnStore::WriteFn write) const {
+  for (uint8_t r = NLiveRanges; r < NRanges; r++) {
+    const Tier& t = tiers[r];
+    if (!write(&t.start, sizeof(t.start)) || !write(&t.acc, sizeof(t.acc)) ||
+        !write(&t.rolled, sizeof(t.rolled)) || !t.store.save(write)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool History::loadRollups(ColumnStore::ReadFn read) {
+  bool ok = true;
+  for (uint8_t r = NLiveRanges; ok && r < NRanges; r++) {
+    Tier& t = tiers[r];
+    ok = read(&t.start, sizeof(t.start)) && read(&t.acc, sizeof(t.acc)) &&
+         read(&t.rolled, sizeof(t.rolled)) && t.store.load(read);
+  }
+  if (ok) return true;
+
+  for (uint8_t r = NLiveRanges; r < NRanges; r++) {
+    Tier& t = tiers[r];
+    t.store.clear();
+    t.start = t.rolled = 0;
+    memset(&t.acc, 0, sizeof(t.acc));
+  }
+  return false;
+}
+
+void History::loop(uint32_t now) {
+  // In order, so that a period closing in one range is folded into the
+  // next before that range's own period closes
+  for (uint8_t r = 0; r < NRanges; r++) advance(r, now);
+}
+
+History::Cursor History::samplesAfter(Range r, uint32_t since) const {
+  const Tier& t = tiers[r];
+  if (t.store.size()) {
+    uint32_t newest = t.store.newest().ts;
+    if (newest > t.span && since < newest - t.span) since = newest - t.span;
+  }
+  Cursor c;
+  c.rows = t.store.rowsAfter(since);
+  return c;
+}
+
+History::Cursor History::samplesFrom(Range r, uint32_t start) const {
+  Cursor c;
+  c.rows = tiers[r].store.rowsAfter(start ? start - 1 : 0);
+  return c;
+}
+
+History::Range History::rangeReaching(uint32_t start) const {
+  Range best = Hour;
+  for (uint8_t r = 0; r < NRanges; r++) {
+    uint32_t o = oldest((Range)r);
+    if (o == 0) continue;
+    if (o <= start) return (Range)r;
+    if (oldest(best) == 0 || o < oldest(best)) best = (Range)r;
+  }
+  return best;
+}
+
+bool History::newest(Range r, Sample& s) const {
+  const ColumnStore& store = tiers[r].store;
+  if (store.size() == 0) return false;
+  fromRow(store.newest(), s);
+  return true;
+}
+
+bool History::Cursor::next(Sample& s) {
+  ColumnStore::Row row;
+  if (!rows.next(row)) return false;
+  fromRow(row, s);
+  return true;
+}
+
+// Moves range r to the period containing ts, closing the current period if
+// ts is beyond it. Returns false if ts can't be recorded in this range.
+bool History::advance(uint8_t r, uint32_t ts) {
+  Tier& t = tiers[r];
+  if (ts < MinValidTime) return false;
+  uint32_t periodStart = ts - (ts % t.period);
+  if (periodStart < t.start) return false;
+  if (periodStart > t.start) {
+    if (t.start) close(r);
+    t.start = periodStart;
+  }
+  return true;
+}
+
+void History::close(uint8_t r) {
+  Tier& t = tiers[r];
+  const Accumulator& a = t.acc;
+  if (a.aqiCount || a.tempCount || a.humiCount || a.pm25Count || a.pressureCount) {
+    Sample s;
+    s.ts = t.start;
+    s.aqi  = average<uint16_t>(a.aqiSum, a.aqiCount, NoAQI);
+    s.nowCast = average<uint16_t>(a.nowCastSum, a.nowCastCount, NoAQI);
+    s.temp = average<int16_t>(a.tempSum, a.tempCount, NoTemp);
+    s.humi = average<uint16_t>(a.humiSum, a.humiCount, NoHumi);
+    s.pm25 = average<uint16_t>(a.pm25Sum, a.pm25Count, NoPM);
+    s.pm25Epa = average<uint16_t>(a.epaSum, a.epaCount, NoPM);
+    s.pressure = average<uint16_t>(a.pressureSum, a.pressureCount, NoPressure);
+    s.aqiMin = a.aqiCount ? a.aqiMin : NoAQI;
+    s.aqiMax = a.aqiCount ? a.aqiMax : NoAQI;
+    s.tempMin = a.tempCount ? a.tempMin : NoTemp;
+    s.tempMax = a.tempCount ? a.tempMax : NoTemp;
+    s.humiMin = a.humiCount ? a.humiMin : NoHumi;
+    s.humiMax = a.humiCount ? a.humiMax : NoHumi;
+    if (r < NLiveRanges) {
+      // The kind of reading that arrived most often
+      const uint16_t counts[] = {a.aqiCount, a.tempCount, a.humiCount, a.pm25Count, a.pressureCount};
+      s.count = 0;
+      for (uint16_t c : counts) if (c > s.count) s.count = c;
+    } else {
+      s.count = a.readings < 0xffff ? a.readings : 0xffff;
+    }
+    ColumnStore::Row row;
+    toRow(s, row);
+    t.store.append(row);
+    if (r + 1 >= NLiveRanges && r + 1 < NRanges) rollUp(r + 1, s);
+  }
+  memset(&t.acc, 0, sizeof(t.acc));
+}
+
+// Folds a sample that has closed in the next finer range into range r
+void History::rollUp(uint8_t r, const Sample& s) {
+  Tier& t = tiers[r];
+  if (s.ts <= t.rolled || !advance(r, s.ts)) return;
+  t.rolled = s.ts;
+
+  Accumulator& a = t.acc;
+  if (s.aqi != NoAQI) {
+    extend(a.aqiMin, a.aqiMax, s.aqiMin, a.aqiCount);
+    extend(a.aqiMin, a.aqiMax, s.aqiMax, 1);
+    a.aqiSum += s.aqi; a.aqiCount++;
+  }
+  if (s.nowCast != NoAQI) { a.nowCastSum += s.nowCast; a.nowCastCount++; }
+  if (s.temp != NoTemp) {
+    extend(a.tempMin, a.tempMax, s.tempMin, a.tempCount);
+    extend(a.tempMin, a.tempMax, s.tempMax, 1);
+    a.tempSum += s.temp; a.tempCount++;
+  }
+  if (s.humi != NoHumi) {
+    extend(a.humiMin, a.humiMax, s.humiMin, a.humiCount);
+    extend(a.humiMin, a.humiMax, s.humiMax, 1);
+    a.humiSum += s.humi; a.humiCount++;
+  }
+  if (s.pm25 != NoPM) { a.pm25Sum += s.pm25; a.pm25Count++; }
+  if (s.pm25Epa != NoPM) { a.epaSum += s.pm25Epa; a.epaCount++; }
+  if (s.pressure != NoPressure) { a.pressureSum += s.pressure; a.pressureCount++; }
+  a.readings += s.count;
+}
@@ -0,0 +1,228 @@
+/*
+ * History
+ *    Keeps hour, day, week, month, and year histories of AQI and weather
+ *    readings
+ *
+ * NOTES:
+ * o AQIMgr and WeatherMgr each keep their own histories, but they can only
+ *   emit an entire range at a time. This history is owned by the app so that
+ *   clients can ask for just the samples they don't have yet. It is an
+ *   addition to theirs, not a replacement: their buffers are allocated by
+ *   WebThingApp and can't be shrunk from here. A History takes about 14 KB
+ *   of RAM on an ESP8266 and 15.5 KB on an ESP32, nearly all of it blocks.
+ * o Each range is a series of samples with a fixed period. A sample holds
+ *   the average of every reading that arrived during its period, along
+ *   with the minimum and maximum AQI, temperature, and humidity, so a
+ *   short spike still shows in a long range, and the number of readings.
+ *   Periods are aligned to multiples of the period length, so AQI and
+ *   weather values for the same period share a timestamp.
+ * o The hour, day, and week ranges are fed directly by readings. The month
+ *   and year ranges are rollups: when a week sample closes it is folded
+ *   into the month range's current period, and when a month sample closes
+ *   it is folded into the year range's. A rollup's averages weight each
+ *   finer sample equally, its extremes are the extremes of theirs, and its
+ *   count is the sum of theirs. (A year sample's count saturates at 65535.)
+ * o Values are stored as scaled integers: temperature in tenths of a
+ *   degree C, humidity in tenths of a percent, pressure in tenths of a
+ *   hPa, and PM2.5 in tenths of a ug/m3. PM2.5 is kept both as measured
+ *   and with the EPA's humidity correction (see src/data/PMHumidityJoin.h).
+ *   A period with no readings of a given kind stores the corresponding
+ *   No* sentinel.
+ * o Closed samples are compressed into a ColumnStore for each range, at
+ *   6 to 7 bytes per sample for typical readings rather than the 32 of a
+ *   Sample, so the blocks hold 4.6 to 5.2 times as many samples as the same
+ *   memory would uncompressed (see tools/bench/HistoryCodecBench.cpp).
+ *   Month samples, which each span a good part of the day's temperature
+ *   cycle, take about 12 bytes, only 2.6 times fewer.
+ *   Samples are read back, oldest first, with a Cursor. A range only
+ *   returns samples within its span of its newest sample. If the values
+ *   are unusually noisy, the store can fill before the span does, and the
+ *   range then covers less time.
+ * o The rollup ranges hold far more than a restart's worth of readings, so
+ *   saveRollups() and loadRollups() let them be kept in flash (see
+ *   src/history/HistoryLog.h). The live ranges are rebuilt from a log.
+ *
+ */
+
+#ifndef History_h
+#define History_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "ColumnStore.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class History {
+public:
+  enum Range : uint8_t { Hour, Day, Week, Month, Year, NRanges };
+  static constexpr uint8_t NLiveRanges = Month;   // Ranges fed by readings
+
+  static constexpr uint16_t NoAQI = 0xffff;
+  static constexpr int16_t  NoTemp = INT16_MIN;
+  static constexpr uint16_t NoHumi = 0xffff;
+  static constexpr uint16_t NoPM = 0xffff;
+  static constexpr uint16_t NoPressure = 0xffff;
+
+  struct Sample {
+    uint32_t ts;    // Start of the sample's period (wall clock seconds)
+    uint16_t aqi;
+    uint16_t nowCast; // NowCast AQI
+    int16_t  temp;  // Tenths of a degree C
+    uint16_t humi;  // Tenths of a percent
+    uint16_t pm25;  // Tenths of a ug/m3, as measured
+    uint16_t pm25Epa; // Tenths of a ug/m3, humidity corrected
+    uint16_t pressure;  // Tenths of a hPa
+    uint16_t aqiMin, aqiMax;
+    int16_t  tempMin, tempMax;
+    uint16_t humiMin, humiMax;
+    uint16_t count;     // Readings averaged into the sample
+  };
+
+  struct Accumulator {
+    uint32_t aqiSum;
+    uint32_t nowCastSum;
+    int32_t  tempSum;
+    uint32_t humiSum;
+    uint32_t pm25Sum;
+    uint32_t epaSum;
+    uint32_t pressureSum;
+    uint16_t aqiCount;
+    uint16_t nowCastCount;
+    uint16_t tempCount;
+    uint16_t humiCount;
+    uint16_t pm25Count;
+    uint16_t epaCount;
+    uint16_t pressureCount;
+    uint16_t aqiMin, aqiMax;
+    int16_t  tempMin, tempMax;
+    uint16_t humiMin, humiMax;
+    uint32_t readings;        // Rollups only: the sum of the samples' counts
+  };
+
+  // The periods each live range is accumulating and what they hold so far
+  struct Progress {
+    uint32_t start[NLiveRanges];
+    Accumulator acc[NLiveRanges];
+  };
+
+  History();
+
+  // Add readings taken at wall clock time ts. Readings that are older than
+  // the period currently being accumulated are ignored. NAN weather values
+  // are ignored, as is a nowCast of NoAQI.
+  void addAQI(uint32_t ts, uint16_t aqi, uint16_t nowCast = NoAQI);
+  void addWeather(uint32_t ts, float temp, float humi, float pressure = NAN);
+  // Values are in tenths. An epa of NoPM is ignored.
+  void addPM25(uint32_t ts, uint16_t pm25, uint16_t epa = NoPM);
+
+  // Adds a sample previously taken from the Hour range, e.g. from a
+  // HistoryLog. Every live range accumulates its values as if they were
+  // count readings taken at the sample's time. The rollup ranges skip
+  // samples they already hold (e.g. from loadRollups()).
+  void restore(const Sample& s);
+
+  // Captures the periods the live ranges have in progress so that they can
+  // be continued after a restart with resume(), e.g. across deep sleep.
+  // Call resume() after any samples have been restored. A range whose
+  // period is older than the one it is already accumulating is left alone.
+  void progress(Progress& p) const;
+  void resume(const Progress& p);
+
+  // Writes, and reads back, the rollup ranges' samples and the periods they
+  // are accumulating. Call loadRollups() before any samples are restored.
+  // It returns false, leaving the rollups empty, if the data is unusable.
+  bool saveRollups(ColumnStore::WriteFn write) const;
+  bool loadRollups(ColumnStore::ReadFn read);
+
+  // Closes any periods that have ended by wall clock time now, even if no
+  // new readings have arrived
+  void loop(uint32_t now);
+
+  uint32_t period(Range r) const { return tiers[r].period; }
+  uint32_t span(Range r) const { return tiers[r].span; }
+
+  class Cursor {
+  public:
+    // Decodes the next sample. Returns false when there are none left.
+    bool next(Sample& s);
+
+  private:
+    friend class History;
+    ColumnStore::Cursor rows;
+  };
+
+  // A Cursor over the samples of the range whose timestamp is greater than
+  // since, oldest first
+  Cursor samplesAfter(Range r, uint32_t since) const;
+
+  // A Cursor over every sample the range holds whose timestamp is at least
+  // start, oldest first. Unlike samplesAfter() it isn't limited to the span.
+  Cursor samplesFrom(Range r, uint32_t start) const;
+
+  // The newest sample of the range. Returns false if there is none.
+  bool newest(Range r, Sample& s) const;
+
+  // The timestamp of the oldest sample the range holds, 0 if none
+  uint32_t oldest(Range r) const { return tiers[r].store.oldestTs(); }
+
+  // The finest range that holds samples as old as start or, if none does,
+  // the one that reaches back furthest
+  Range rangeReaching(uint32_t start) const;
+
+  // The number of samples the range holds, which may reach back further
+  // than its span, and the bytes they occupy
+  uint32_t samplesHeld(Range r) const { return tiers[r].store.size(); }
+  size_t bytesUsed(Range r) const { return tiers[r].store.bytesUsed(); }
+
+private:
+  // Readings taken before the clock has been set are not recorded
+  static constexpr uint32_t MinValidTime = 1577836800;  // 2020-01-01
+
+  // Compressed samples are kept in blocks of BlockSize bytes. Each range
+  // has enough blocks for its span at the bytes per sample that
+  // tools/bench/HistoryCodecBench.cpp measures for typical readings, plus
+  // one. An ESP8266 doesn't have the memory for that, so there the month
+  // range covers about half its span.
+  static constexpr uint16_t BlockSize = 256;
+  #if defined(ESP8266)
+    static constexpr uint8_t  HourBlocks = 3;   // 60 samples of 1 minute
+    static constexpr uint8_t  DayBlocks  = 9;   // 288 samples of 5 minutes
+    static constexpr uint8_t  WeekBlocks = 18;  // 672 samples of 15 minutes
+    static constexpr uint8_t  MonthBlocks = 7;  // 140 samples of 3 hours
+    static constexpr uint8_t  YearBlocks = 11;  // 365 samples of 1 day
+  #else
+    static constexpr uint8_t  HourBlocks = 3;   // 60 samples of 1 minute
+    static constexpr uint8_t  DayBlocks  = 9;   // 288 samples of 5 minutes
+    static constexpr uint8_t  WeekBlocks = 18;  // 672 samples of 15 minutes
+    static constexpr uint8_t  MonthBlocks = 13; // 240 samples of 3 hours
+    static constexpr uint8_t  YearBlocks = 11;  // 365 samples of 1 day
+  #endif
+
+  struct Tier {
+    uint32_t period;
+    uint32_t span;      // Samples older than this, relative to the newest, aren't returned
+    ColumnStore store;
+    uint32_t start;     // Start of the period being accumulated, 0 if none
+    Accumulator acc;
+    uint32_t rolled;    // Rollups only: ts of the newest sample folded in
+  };
+
+  Tier tiers[NRanges];
+  uint8_t hourBlocks[HourBlocks * BlockSize];
+  uint8_t dayBlocks[DayBlocks * BlockSize];
+  uint8_t weekBlocks[WeekBlocks * BlockSize];
+  uint8_t monthBlocks[MonthBlocks * BlockSize];
+  uint8_t yearBlocks[YearBlocks * BlockSize];
+
+  bool advance(uint8_t r, uint32_t ts);
+  void close(uint8_t r);
+  void rollUp(uint8_t r, const Sample& s);
+};
+
+#endif  // History_h
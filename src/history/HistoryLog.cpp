@@ -0,0 +1,255 @@
+/*
+ * HistoryLog
+ *    Keeps the app's history in flash so that it survives a reboot
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  WebThing Includes
+#include <ESP_FS.h>
+//                                  Local Includes
+#include "HistoryLog.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  constexpr size_t MaxPathLength = 16;
+  const char* TrimPath = "/histtrim.log";
+}
+
+void HistoryLog::segmentPath(uint8_t segment, char* path) {
+  snprintf(path, MaxPathLength, "/hist%u.log", segment);
+}
+
+void HistoryLog::rollupPath(uint32_t seq, char* path) {
+  snprintf(path, MaxPathLength, "/rollup%u.dat", (unsigned)(seq % 2));
+}
+
+HistoryLog::Record HistoryLog::toRecord(const History::Sample& s) {
+  return {s.ts, s.aqi, s.nowCast, s.temp, s.humi, s.pm25, s.pm25Epa, s.pressure};
+}
+
+History::Sample HistoryLog::toSample(const Record& r) {
+  History::Sample s;
+  s.ts = r.ts;
+  s.aqi = s.aqiMin = s.aqiMax = r.aqi;
+  s.nowCast = r.nowCast;
+  s.temp = s.tempMin = s.tempMax = r.temp;
+  s.humi = s.humiMin = s.humiMax = r.humi;
+  s.pm25 = r.pm25;
+  s.pm25Epa = r.pm25Epa;
+  s.pressure = r.pressure;
+  s.count = 1;
+  return s;
+}
+
+void HistoryLog::begin() {
+  char path[MaxPathLength];
+  for (uint8_t i = 0; i < NSegments; i++) {
+    days[i] = NoDay;
+    segmentPath(i, path);
+    if (!ESP_FS::exists(path)) continue;
+    File f = ESP_FS::open(path, "r");
+    if (!f) continue;
+    Header h;
+    if (f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == Magic) days[i] = h.day;
+    f.close();
+  }
+}
+
+void HistoryLog::restore(RestoreFn fn) {
+  uint32_t newest = 0;
+  for (uint8_t i = 0; i < NSegments; i++) {
+    if (days[i] != NoDay && days[i] + 1 > newest) newest = days[i] + 1;
+  }
+  if (newest == 0) return;
+  uint32_t oldestDay = (newest > NSegments) ? newest - NSegments : 0;
+
+  // Replay the segments in day order. There are only NSegments of them, so
+  // a simple selection of the next oldest day is fine.
+  uint32_t after = oldestDay;
+  uint32_t restored = 0;
+  char path[MaxPathLength];
+  Record chunk[BatchSize];
+  for (;;) {
+    int8_t next = -1;
+    for (uint8_t i = 0; i < NSegments; i++) {
+      if (days[i] == NoDay || days[i] < after) continue;
+      if (next < 0 || days[i] < days[next]) next = i;
+    }
+    if (next < 0) break;
+    after = days[next] + 1;
+
+    segmentPath(next, path);
+    File f = ESP_FS::open(path, "r");
+    if (!f) continue;
+    f.seek(sizeof(Header));
+    size_t n;
+    while ((n = f.read((uint8_t*)chunk, sizeof(chunk)) / sizeof(Record)) > 0) {
+      for (size_t r = 0; r < n; r++) {
+        // Left over from a misaligned append, or otherwise garbage
+        if (chunk[r].ts / SegmentSpan != days[next]) continue;
+        fn(toSample(chunk[r]));
+        if (chunk[r].ts > lastLogged) lastLogged = chunk[r].ts;
+        restored++;
+      }
+    }
+    f.close();
+  }
+  Log.trace(F("HistoryLog::restore: %d records"), restored);
+}
+
+void HistoryLog::adopt(const Record* records, uint8_t n, RestoreFn fn) {
+  for (uint8_t i = 0; i < n; i++) {
+    if (records[i].ts <= lastLogged) continue;
+    append(records[i]);
+    fn(toSample(records[i]));
+  }
+}
+
+void HistoryLog::loop(const History& history) {
+  History::Sample s;
+  if (history.newest(History::Month, s) && s.ts > lastRollup) saveRollups(history, s.ts);
+  if (!history.newest(History::Hour, s) || s.ts <= lastLogged) return;
+
+  // Usually just the newest sample is new, but more may have closed at once
+  History::Cursor c = history.samplesAfter(History::Hour, lastLogged);
+  while (c.next(s)) append(toRecord(s));
+}
+
+bool HistoryLog::loadRollups(History& history) {
+  // Find the complete snapshots and try the newer first
+  uint32_t seqs[2] = {0, 0};
+  char path[MaxPathLength];
+  for (uint8_t i = 0; i < 2; i++) {
+    rollupPath(i, path);
+    if (!ESP_FS::exists(path)) continue;
+    File f = ESP_FS::open(path, "r");
+    if (!f) continue;
+    RollupHeader h;
+    uint32_t trailer;
+    if (f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == RollupMagic &&
+        f.size() > sizeof(h) + sizeof(trailer) && f.seek(f.size() - sizeof(trailer)) &&
+        f.read((uint8_t*)&trailer, sizeof(trailer)) == sizeof(trailer) && trailer == h.seq) {
+      seqs[i] = h.seq;
+    }
+    f.close();
+  }
+
+  uint8_t first = seqs[1] > seqs[0] ? 1 : 0;
+  for (uint8_t i = first; i < first + 2; i++) {
+    uint32_t seq = seqs[i % 2];
+    if (seq == 0) continue;
+    rollupPath(i, path);
+    File f = ESP_FS::open(path, "r");
+    if (!f) continue;
+    f.seek(sizeof(RollupHeader));
+    bool loaded = history.loadRollups([&f](void* data, size_t size) {
+      return f.read((uint8_t*)data, size) == size;
+    });
+    f.close();
+    if (loaded) {
+      rollupSeq = seq;
+      History::Sample s;
+      if (history.newest(History::Month, s)) lastRollup = s.ts;
+      Log.trace(F("HistoryLog::loadRollups: Loaded snapshot %d"), seq);
+      return true;
+    }
+  }
+  return false;
+}
+
+void HistoryLog::saveRollups(const History& history, uint32_t newestMonth) {
+  lastRollup = newestMonth;
+  uint32_t seq = rollupSeq + 1;
+  char path[MaxPathLength];
+  rollupPath(seq, path);
+  File f = ESP_FS::open(path, "w");
+  if (!f) {
+    Log.warning(F("HistoryLog::saveRollups: Unable to open %s"), path);
+    return;
+  }
+  RollupHeader h = {RollupMagic, seq};
+  bool ok = f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+      history.saveRollups([&f](const void* data, size_t size) {
+        return f.write((const uint8_t*)data, size) == size;
+      }) &&
+      f.write((const uint8_t*)&seq, sizeof(seq)) == sizeof(seq);
+  f.close();
+  // Even if the write failed the other snapshot is still good, so the next
+  // attempt goes to this file again
+  if (ok) rollupSeq = seq;
+  else Log.warning(F("HistoryLog::saveRollups: Unable to write %s"), path);
+}
+
+void HistoryLog::append(const Record& r) {
+  // A batch only ever holds records for one segment
+  if (pending && r.ts / SegmentSpan != batch[0].ts / SegmentSpan) flush();
+  batch[pending++] = r;
+  lastLogged = r.ts;
+  if (pending == BatchSize) flush();
+}
+
+void HistoryLog::flush() {
+  if (pending == 0) return;
+
+  uint32_t day = batch[0].ts / SegmentSpan;
+  uint8_t segment = day % NSegments;
+  char path[MaxPathLength];
+  segmentPath(segment, path);
+
+  File f;
+  if (days[segment] == day) {
+    f = ESP_FS::open(path, "a");
+    size_t size = f ? f.size() : 0;
+    if (f && (size < sizeof(Header) || (size - sizeof(Header)) % sizeof(Record) != 0)) {
+      f.close();
+      if (trim(path, size)) f = ESP_FS::open(path, "a");
+      else days[segment] = NoDay;   // Start the segment over
+    }
+  }
+  if (days[segment] != day) {
+    f = ESP_FS::open(path, "w");
+    if (f) {
+      Header h = {Magic, day};
+      f.write((const uint8_t*)&h, sizeof(h));
+      days[segment] = day;
+    }
+  }
+  if (!f) {
+    Log.warning(F("HistoryLog::flush: Unable to open %s"), path);
+  } else {
+    f.write((const uint8_t*)batch, pending * sizeof(Record));
+    f.close();
+  }
+  pending = 0;
+}
+
+// A partial record at the end of a segment would misalign every record
+// appended after it. Neither file system can shrink a file in place, so the
+// header and the whole records are copied to a new file that replaces the
+// segment. This only happens after an interrupted write.
+bool HistoryLog::trim(const char* path, size_t size) {
+  if (size < sizeof(Header)) return false;
+  size_t keep = sizeof(Header) + (size - sizeof(Header)) / sizeof(Record) * sizeof(Record);
+  Log.warning(F("HistoryLog::trim: Dropping a partial record from %s"), path);
+
+  File from = ESP_FS::open(path, "r");
+  File to = ESP_FS::open(TrimPath, "w");
+  bool ok = from && to;
+  uint8_t buf[BatchSize * sizeof(Record)];
+  for (size_t copied = 0; ok && copied < keep; ) {
+    size_t n = keep - copied < sizeof(buf) ? keep - copied : sizeof(buf);
+    ok = from.read(buf, n) == n && to.write(buf, n) == n;
+    copied += n;
+  }
+  if (from) from.close();
+  if (to) to.close();
+  ok = ok && ESP_FS::remove(path) && ESP_FS::rename(TrimPath, path);
+  if (!ok) Log.warning(F("HistoryLog::trim: Unable to trim %s"), path);
+  return ok;
+}
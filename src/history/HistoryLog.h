@@ -0,0 +1,136 @@
+/*
+ * HistoryLog
+ *    Keeps the app's history in flash so that it survives a reboot
+ *
+ * NOTES:
+ * o Every minute-long sample that History's Hour range closes is appended
+ *   to a log as a fixed-size Record holding its averages. At boot the log
+ *   is read back once, sequentially, and replayed into History, which
+ *   rebuilds the hour, day, and week ranges. (They are rebuilt from the
+ *   minute averages, so their averages can differ slightly from the
+ *   originals and their extremes are those of the minute averages.)
+ * o The log is split into NSegments files, one per day, named
+ *   /hist0.log ... /hist7.log. A record goes into the segment for its day,
+ *   day % NSegments, and the first write of a new day truncates whatever
+ *   older day that segment held. Nothing is ever rewritten in place and
+ *   the log never holds more than NSegments days.
+ * o Each segment starts with a Header recording its day. A file whose
+ *   magic doesn't match is ignored, as is a partial record at the end of a
+ *   file (e.g. after a power loss during a write). Before appending to a
+ *   segment that ends with a partial record, flush() trims it back to the
+ *   last whole record so later records stay aligned. As a further guard,
+ *   restore() skips any record that doesn't belong to its segment's day.
+ * o Records are buffered and written BatchSize at a time, so the flash is
+ *   written about every quarter hour rather than every minute. flush()
+ *   writes whatever is buffered and should be called before a deliberate
+ *   restart. Across deep sleep the app can instead carry the unwritten
+ *   records in RTC memory and adopt() them on wake (see
+ *   src/data/SleepState.h). At most a batch is lost in an unexpected reset.
+ * o The month and year ranges reach back much further than the log, so
+ *   each time a month sample closes, every few hours, saveRollups() writes
+ *   a snapshot of both ranges. Snapshots alternate between /rollup0.dat
+ *   and /rollup1.dat and end with a trailer matching their header, so an
+ *   interrupted write leaves the previous snapshot intact. At boot,
+ *   loadRollups() reads the newest complete snapshot before the log is
+ *   replayed; History ignores replayed samples the snapshot already holds.
+ * o Records are written in the processor's own layout; the log is only
+ *   ever read back by the device that wrote it.
+ *
+ */
+
+#ifndef HistoryLog_h
+#define HistoryLog_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+#include <functional>
+//                                  Local Includes
+#include "History.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class HistoryLog {
+public:
+  // A sample from History's Hour range, as it is kept in the log
+  struct Record {
+    uint32_t ts;
+    uint16_t aqi;
+    uint16_t nowCast;
+    int16_t  temp;
+    uint16_t humi;
+    uint16_t pm25;
+    uint16_t pm25Epa;
+    uint16_t pressure;
+  };
+  using RestoreFn = std::function<void(const History::Sample&)>;
+
+  static Record toRecord(const History::Sample& s);
+  // The extremes of the sample are its averages and its count is 1
+  static History::Sample toSample(const Record& r);
+
+  static constexpr uint8_t NSegments = 8;
+  static constexpr uint32_t SegmentSpan = 24 * 60 * 60L;   // seconds
+  static constexpr uint8_t BatchSize = 16;
+
+  // Reads the segment headers. Call once the file system is mounted.
+  void begin();
+
+  // Reads the newest complete snapshot of the month and year ranges into
+  // history. Call before restore(). Returns false if there was none.
+  bool loadRollups(History& history);
+
+  // Replays every record in the log, oldest first, that is within
+  // NSegments-1 days of the newest record. Restoring the History itself is
+  // up to fn, which may also feed other consumers (e.g. the NowCast).
+  void restore(RestoreFn fn);
+
+  // Appends any samples that have closed since the last call, and writes a
+  // snapshot of the month and year ranges if a month sample has closed.
+  // Call after History::loop().
+  void loop(const History& history);
+
+  // Writes the buffered records
+  void flush();
+
+  // The records that are buffered but not yet written
+  uint8_t unwritten(const Record*& records) const { records = batch; return pending; }
+
+  // Takes back records that were buffered but not written before a restart
+  // (e.g. kept in RTC memory across deep sleep). Call after restore().
+  // Records that are already in the log are skipped; the rest are buffered
+  // again and passed to fn, as samples, just as restore() would.
+  void adopt(const Record* records, uint8_t n, RestoreFn fn);
+
+private:
+  static constexpr uint32_t Magic = 0x32474c50;   // "PLG2"
+  static constexpr uint32_t NoDay = 0xffffffff;
+  static constexpr uint32_t RollupMagic = 0x32555250;   // "PRU2"
+
+  struct Header {
+    uint32_t magic;
+    uint32_t day;       // ts / SegmentSpan of every record in the segment
+  };
+
+  // A snapshot is a RollupHeader, History's rollups, and a trailer that
+  // repeats seq
+  struct RollupHeader {
+    uint32_t magic;
+    uint32_t seq;       // Increases with every snapshot written
+  };
+
+  uint32_t days[NSegments];   // The day held by each segment, or NoDay
+  Record batch[BatchSize];
+  uint8_t pending = 0;
+  uint32_t lastLogged = 0;    // ts of the newest record logged or restored
+  uint32_t rollupSeq = 0;     // Of the newest snapshot, 0 if none
+  uint32_t lastRollup = 0;    // ts of the newest month sample in that snapshot
+
+  static void segmentPath(uint8_t segment, char* path);
+  static void rollupPath(uint32_t seq, char* path);
+  static bool trim(const char* path, size_t size);
+  void append(const Record& r);
+  void saveRollups(const History& history, uint32_t newestMonth);
+};
+
+#endif  // HistoryLog_h
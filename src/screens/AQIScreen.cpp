@@ -17,8 +17,8 @@
 
 
 void AQIScreen::display(bool) {
-  const AQIReadings& aqiReadings = phApp->aqiMgr.getLastReadings();
-  auto aqi = phApp->aqiMgr.derivedAQI(aqiReadings.env.pm25);
+  const DerivedAQI& derived = phApp->aqiValues.derived();
+  uint16_t aqi = derived.aqi;
   Display.oled->clear();
 
 
@@ -38,13 +38,13 @@ void AQIScreen::display(bool) {
   uint16_t rightColumnCenter = Display.XCenter + Display.XCenter/2 - offset;
   Display.setFont(font);
   Display.oled->setTextAlignment(TEXT_ALIGN_CENTER);
-  Display.oled->drawString(rightColumnCenter, 5 + yOffset, String(aqi));
+  Display.oled->drawString(rightColumnCenter, 5 + yOffset, phApp->aqiValues.value(AQIValueCache::AQI));
 
   Display.setFont(Display.FontID::SB12);
   Display.oled->setTextAlignment(TEXT_ALIGN_CENTER);
   Display.oled->drawString(rightColumnCenter, 49, "AQI");
 
-  const uint8_t* aqiIcon = AQILevels[phApp->aqiMgr.aqiBracket(aqi)];
+  const uint8_t* aqiIcon = AQILevels[derived.bracket];
   Display.oled->drawXbm(0, 0, AQI_ICON_WIDTH, AQI_ICON_HEIGHT, aqiIcon);
 
   Display.oled->display();
@@ -0,0 +1,116 @@
+#include <gui/devices/DeviceSelect.h>
+#if DEVICE_TYPE == DEVICE_TYPE_OLED
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+#include <Output.h>
+#include <TimeLib.h>
+//                                  WebThingApp
+#include <gui/Display.h>
+//                                  Local Includes
+#include "../../PurpleHazeApp.h"
+#include "HistoryGraphScreen.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  constexpr int16_t Top = 13;     // First row of the plot, below the heading
+  const char* RangeNames[History::NRanges] = {"Hour", "Day", "Week", "Month", "Year"};
+}
+
+void HistoryGraphScreen::selectRange(uint8_t r) {
+  range = (History::Range)(r < History::NRanges ? r : History::NRanges - 1);
+  newestShown = 0;
+}
+
+bool HistoryGraphScreen::extract(
+    const History::Sample& s, int32_t& avg, int32_t& lo, int32_t& hi) const
+{
+  if (value == Value::AQI) {
+    if (s.aqi == History::NoAQI) return false;
+    avg = s.aqi; lo = s.aqiMin; hi = s.aqiMax;
+  } else {
+    if (s.temp == History::NoTemp) return false;
+    avg = s.temp; lo = s.tempMin; hi = s.tempMax;
+  }
+  return true;
+}
+
+void HistoryGraphScreen::display(bool) {
+  const History& history = phApp->history;
+  auto oled = Display.oled;
+  const int16_t Bottom = Display.Height - 1;
+  oled->clear();
+
+  // First pass: the time covered and the extremes, for the scales
+  History::Sample s;
+  bool any = history.newest(range, s);
+  uint32_t end = any ? s.ts + history.period(range) : 0;
+  uint32_t start = end > history.span(range) ? end - history.span(range) : 0;
+  newestShown = any ? s.ts : 0;
+
+  int32_t minV = INT32_MAX, maxV = INT32_MIN;
+  int32_t avg, lo, hi;
+  History::Cursor c = history.samplesAfter(range, 0);
+  while (c.next(s)) {
+    if (!extract(s, avg, lo, hi)) continue;
+    if (lo < minV) minV = lo;
+    if (hi > maxV) maxV = hi;
+  }
+
+  char heading[32];
+  const char* name = (value == Value::AQI) ? "AQI" : "Temp";
+  Display.setFont(Display.FontID::S10);
+  oled->setTextAlignment(TEXT_ALIGN_LEFT);
+  snprintf(heading, sizeof(heading), "%s: %s", name, RangeNames[range]);
+  oled->drawString(0, 0, heading);
+
+  if (minV > maxV) {
+    oled->setTextAlignment(TEXT_ALIGN_CENTER);
+    oled->drawString(Display.XCenter, (Top + Bottom)/2 - 5, "No history yet");
+    oled->display();
+    return;
+  }
+
+  if (value == Value::AQI) {
+    snprintf(heading, sizeof(heading), "%d - %d", (int)minV, (int)maxV);
+  } else {
+    snprintf(heading, sizeof(heading), "%.0f - %.0f%s",
+        Output::temp(minV / 10.0f), Output::temp(maxV / 10.0f), Output::tempUnits());
+  }
+  oled->setTextAlignment(TEXT_ALIGN_RIGHT);
+  oled->drawString(Display.Width - 1, 0, heading);
+
+  // Second pass: the average as a line, the extremes as dots
+  int32_t spread = (maxV > minV) ? maxV - minV : 1;
+  auto y = [=](int32_t v) -> int16_t { return Bottom - (v - minV) * (Bottom - Top) / spread; };
+  uint32_t span = end - start;
+  int16_t prevX = -1, prevY = 0;
+  c = history.samplesAfter(range, 0);
+  while (c.next(s)) {
+    if (!extract(s, avg, lo, hi) || s.ts < start) continue;
+    int16_t x = (uint64_t)(s.ts - start) * Display.Width / span;
+    oled->setPixel(x, y(lo));
+    oled->setPixel(x, y(hi));
+    int16_t ay = y(avg);
+    if (prevX >= 0) oled->drawLine(prevX, prevY, x, ay);
+    else oled->setPixel(x, ay);
+    prevX = x; prevY = ay;
+  }
+
+  oled->display();
+}
+
+void HistoryGraphScreen::processPeriodicActivity() {
+  // Every minute check whether the range has a new sample. If so, redraw.
+  uint32_t thisMinute = minute();
+  if (thisMinute != lastMinute) {
+    lastMinute = thisMinute;
+    History::Sample s;
+    if (phApp->history.newest(range, s) && s.ts != newestShown) display(true);
+  }
+}
+
+#endif
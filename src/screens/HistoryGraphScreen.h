@@ -0,0 +1,60 @@
+/*
+ * HistoryGraphScreen
+ *    Graphs a range of the app's history of AQI or temperature
+ *
+ * NOTES:
+ * o The graph screens that come with WebThingApp draw from the sensor
+ *   managers' buffers, which only go back a week and hold one value per
+ *   period. This screen draws from the app's History instead, so it can
+ *   show the month and year ranges too.
+ * o The range's span is divided among the display's columns. The average
+ *   is drawn as a line and each sample's minimum and maximum as dots above
+ *   and below it, so short spikes remain visible in the longer ranges.
+ * o The vertical scale fits the extremes of the samples on screen. They
+ *   are shown in the heading.
+ *
+ */
+
+#include <gui/devices/DeviceSelect.h>
+#if DEVICE_TYPE == DEVICE_TYPE_OLED
+
+#ifndef HistoryGraphScreen_h
+#define HistoryGraphScreen_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  WebThing Includes
+#include <gui/Screen.h>
+//                                  Local Includes
+#include "../history/History.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class HistoryGraphScreen : public Screen {
+public:
+  enum class Value : uint8_t { AQI, Temp };
+
+  HistoryGraphScreen(Value value) : value(value) { }
+
+  virtual void display(bool) override;
+  virtual void processPeriodicActivity() override;
+
+  // Selects the History::Range to graph, as stored in the graphRange
+  // settings
+  void selectRange(uint8_t range);
+
+private:
+  Value value;
+  History::Range range = History::Hour;
+  uint32_t newestShown = 0;   // ts of the newest sample graphed
+  uint32_t lastMinute = 0;
+
+  // The sample's average, minimum, and maximum of the value. Returns false
+  // if the sample doesn't have the value.
+  bool extract(const History::Sample& s, int32_t& avg, int32_t& lo, int32_t& hi) const;
+};
+
+#endif  // HistoryGraphScreen_h
+#endif
@@ -110,7 +110,7 @@ void HomeScreen::drawReadings() {
   String readings[3];
   #if defined(HAS_AQI_SENSOR) && defined(HAS_WEATHER_SENSOR)
     // AQI    TEMP        HUMI
-    readings[0] = String(phApp->aqiMgr.derivedAQI(phApp->aqiMgr.getLastReadings().env.pm25));
+    readings[0] = phApp->aqiValues.value(AQIValueCache::AQI);
     readings[1] = String(Output::temp(phApp->weatherMgr.getLastReadings().temp), 0);
     readings[2] = String(phApp->weatherMgr.getLastReadings().humidity, 0);
     lastReadingTime = max(
@@ -118,7 +118,7 @@ void HomeScreen::drawReadings() {
       phApp->aqiMgr.getLastReadings().timestamp);
   #elif defined(HAS_AQI_SENSOR)
     // AQI    OWM_TEMP    OWM_HUMI
-    readings[0] = String(phApp->aqiMgr.derivedAQI(phApp->aqiMgr.getLastReadings().env.pm25));
+    readings[0] = phApp->aqiValues.value(AQIValueCache::AQI);
     readings[1] = String(phApp->owmClient->weather.readings.temp, 0);
     readings[2] = String(phApp->owmClient->weather.readings.humidity, 0);
     lastReadingTime = phApp->aqiMgr.getLastReadings().timestamp;
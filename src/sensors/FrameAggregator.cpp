@@ -0,0 +1,59 @@
+/*
+ * FrameAggregator
+ *    Folds the ~1 Hz PMS5003 frames into per-interval summaries
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+//                                  Local Includes
+#include "FrameAggregator.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+bool FrameAggregator::add(const AQIReadings& r) {
+  bool closed = false;
+  if (frames == 0) begin(r.timestamp);
+  else if (r.timestamp - start >= interval) {
+    closed = close();
+    begin(r.timestamp);
+  }
+
+  for (uint8_t i = 0; i < NFields; i++) {
+    uint16_t v = PMS5003Parser::field(r, i);
+    sum[i] += v;
+    if (v < lo[i]) lo[i] = v;
+    if (v > hi[i]) hi[i] = v;
+    median[i].add(v);
+  }
+  frames++;
+  last = r.timestamp;
+  return closed;
+}
+
+bool FrameAggregator::close() {
+  if (frames == 0) return false;
+  for (uint8_t i = 0; i < NFields; i++) {
+    PMS5003Parser::setField(_summary.mean, i, (sum[i] + frames/2) / frames);
+    PMS5003Parser::setField(_summary.min, i, lo[i]);
+    PMS5003Parser::setField(_summary.max, i, hi[i]);
+    PMS5003Parser::setField(_summary.median, i, lroundf(median[i].value()));
+  }
+  _summary.mean.timestamp = _summary.min.timestamp = last;
+  _summary.max.timestamp = _summary.median.timestamp = last;
+  _summary.frames = frames;
+  frames = 0;
+  return true;
+}
+
+void FrameAggregator::begin(uint32_t t) {
+  start = t;
+  frames = 0;
+  for (uint8_t i = 0; i < NFields; i++) {
+    sum[i] = 0;
+    lo[i] = UINT16_MAX;
+    hi[i] = 0;
+    median[i].reset();
+  }
+}
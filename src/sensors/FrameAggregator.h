@@ -0,0 +1,83 @@
+/*
+ * FrameAggregator
+ *    Folds the ~1 Hz PMS5003 frames into per-interval summaries
+ *
+ * NOTES:
+ * o For every field of the readings the aggregator keeps a running sum,
+ *   min, max, and a P² estimate of the median. Frames themselves are never
+ *   stored, so memory use doesn't depend on the interval length.
+ * o add() closes the current interval when a frame arrives at or after the
+ *   interval's end. The frame that closes an interval starts the next one.
+ *   close() closes it right away. The app does that when a duty-cycled
+ *   sensor goes back to sleep, since otherwise the sample would wait for
+ *   the first frame of the next one, a whole cycle later.
+ * o A summary is stamped with the time of its interval's last frame.
+ * o The median is the robust value the rest of the app uses: the app
+ *   presents it to AQIMgr, so history, AIO, and the screens all see one
+ *   de-noised reading per interval instead of whichever raw frame happened
+ *   to be current.
+ * o The interval needn't be fixed; the app follows AdaptiveCadence.
+ *
+ */
+
+#ifndef FrameAggregator_h
+#define FrameAggregator_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  WebThing Includes
+#include <sensors/AQIMgr.h>
+//                                  Local Includes
+#include "../util/P2Quantile.h"
+#include "PMS5003Parser.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class FrameAggregator {
+public:
+  static constexpr uint32_t DefaultInterval = 60 * 1000L;   // ms
+
+  struct Summary {
+    uint32_t frames;      // Number of frames in the interval
+    AQIReadings mean;     // Each timestamp is that of the last frame
+    AQIReadings min;
+    AQIReadings max;
+    AQIReadings median;
+  };
+
+  explicit FrameAggregator(uint32_t interval = DefaultInterval) : interval(interval) { }
+
+  // Folds in a frame. Returns true if the frame closed an interval, in which
+  // case summary() describes that interval.
+  bool add(const AQIReadings& r);
+
+  // Closes the interval in progress. Returns false if it has no frames,
+  // otherwise summary() describes it.
+  bool close();
+
+  // Changes the interval length. It applies to the interval in progress, so
+  // shortening it closes that interval with the next frame.
+  void setInterval(uint32_t ms) { interval = ms; }
+  uint32_t getInterval() const { return interval; }
+
+  bool hasSummary() const { return _summary.frames != 0; }
+  const Summary& summary() const { return _summary; }
+
+private:
+  static constexpr uint8_t NFields = PMS5003Parser::NFields;
+
+  uint32_t interval;
+  uint32_t start = 0;
+  uint32_t frames = 0;
+  uint32_t last = 0;      // Timestamp of the latest frame
+  uint32_t sum[NFields];
+  uint16_t lo[NFields];
+  uint16_t hi[NFields];
+  P2Quantile median[NFields];
+  Summary _summary = {};
+
+  void begin(uint32_t t);
+};
+
+#endif  // FrameAggregator_h
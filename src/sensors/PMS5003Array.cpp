@@ -0,0 +1,112 @@
+/*
+ * PMS5003Array
+ *    Combines the frames from several PMS5003 sensors into a single stream
+ *    of readings
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+//                                  Local Includes
+#include "PMS5003Array.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  uint8_t countBits(uint8_t mask) {
+    uint8_t n = 0;
+    for (; mask; mask &= mask - 1) n++;
+    return n;
+  }
+
+  // Index of env PM2.5 in PMS5003Parser's field order
+  constexpr uint8_t PM25Env = 4;
+}
+
+void PMS5003Array::add(uint8_t ch, const AQIReadings& r) {
+  if (ch >= nChannels) return;
+  channels[ch].latest = r;
+  channels[ch].frames++;
+
+  if (nChannels == 1) {
+    if (frameHandler) frameHandler(r);
+    return;
+  }
+
+  uint32_t now = r.timestamp;
+  if (ch != lead(now)) return;
+
+  uint8_t fresh = 0;
+  for (uint8_t i = 0; i < nChannels; i++) {
+    if (channels[i].frames && now - channels[i].latest.timestamp <= FreshWindow) fresh |= (1 << i);
+  }
+  trackDrift(fresh);
+
+  // Outvote drifting channels if there are enough others to go on
+  uint8_t included = fresh;
+  if (countBits(fresh) >= 3) {
+    uint8_t trusted = fresh;
+    for (uint8_t i = 0; i < nChannels; i++) {
+      if (channels[i].drifting) trusted &= ~(1 << i);
+    }
+    if (trusted) included = trusted;
+  }
+
+  uint32_t sums[PMS5003Parser::NFields] = {};
+  uint8_t n = countBits(included);
+  for (uint8_t i = 0; i < nChannels; i++) {
+    if (!(included & (1 << i))) continue;
+    for (uint8_t f = 0; f < PMS5003Parser::NFields; f++) {
+      sums[f] += PMS5003Parser::field(channels[i].latest, f);
+    }
+  }
+
+  AQIReadings combined = r;
+  for (uint8_t f = 0; f < PMS5003Parser::NFields; f++) {
+    PMS5003Parser::setField(combined, f, (sums[f] + n/2) / n);
+  }
+  if (frameHandler) frameHandler(combined);
+}
+
+bool PMS5003Array::isStale(uint8_t i, uint32_t now) const {
+  return channels[i].frames == 0 || now - channels[i].latest.timestamp > StaleAfter;
+}
+
+uint8_t PMS5003Array::faults(uint32_t now) const {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < nChannels; i++) {
+    if (isStale(i, now) || channels[i].drifting) mask |= (1 << i);
+  }
+  return mask;
+}
+
+uint8_t PMS5003Array::lead(uint32_t now) const {
+  for (uint8_t i = 0; i < nChannels; i++) {
+    if (!isStale(i, now)) return i;
+  }
+  return 0;
+}
+
+void PMS5003Array::trackDrift(uint8_t fresh) {
+  uint8_t n = countBits(fresh);
+  if (n < 2) return;
+
+  float total = 0;
+  for (uint8_t i = 0; i < nChannels; i++) {
+    if (fresh & (1 << i)) total += PMS5003Parser::field(channels[i].latest, PM25Env);
+  }
+
+  for (uint8_t i = 0; i < nChannels; i++) {
+    if (!(fresh & (1 << i))) continue;
+    Channel& c = channels[i];
+    float mine = PMS5003Parser::field(c.latest, PM25Env);
+    float others = (total - mine) / (n - 1);
+    c.bias += (mine - others - c.bias) * DriftSmoothing;
+    c.level += (total / n - c.level) * DriftSmoothing;
+
+    float limit = fmaxf(DriftAbsolute, DriftRelative * c.level);
+    if (!c.drifting && fabsf(c.bias) > limit) c.drifting = true;
+    else if (c.drifting && fabsf(c.bias) < limit / 2) c.drifting = false;
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ * PMS5003Array
+ *    Combines the frames from several PMS5003 sensors into a single stream
+ *    of readings and flags any sensor that disagrees with the others
+ *
+ * NOTES:
+ * o Each sensor has its own PMS5003Link (and so its own ring and parser)
+ *   whose frame handler calls add() with the sensor's channel number.
+ * o The sensors aren't synchronized. Whenever the lead channel (the lowest
+ *   numbered channel that isn't stale) delivers a frame, the latest frames
+ *   of every channel heard from within FreshWindow are averaged field by
+ *   field and the result goes to the frame handler. Consumers see one
+ *   AQIReadings stream, just as with a single sensor.
+ * o A channel that hasn't delivered a frame for StaleAfter is stale and is
+ *   left out. If the lead goes stale, the next channel takes over.
+ * o Drift is tracked on env PM2.5, the value the AQI is derived from. For
+ *   each channel an exponential moving average of its difference from the
+ *   mean of the other channels is kept. A channel drifts when that bias
+ *   exceeds both DriftAbsolute and DriftRelative of the overall level, the
+ *   same kind of test PurpleAir applies to its A and B channels. The flag
+ *   clears when the bias falls to half of those thresholds.
+ * o With three or more channels a drifting channel is outvoted and left out
+ *   of the average. With two there is no way to tell which one is wrong, so
+ *   both are flagged and both are still averaged.
+ * o With a single channel, frames are passed straight through.
+ *
+ */
+
+#ifndef PMS5003Array_h
+#define PMS5003Array_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+#include <functional>
+//                                  WebThing Includes
+#include <sensors/AQIMgr.h>
+//                                  Local Includes
+#include "PMS5003Parser.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class PMS5003Array {
+public:
+  using FrameHandler = std::function<void(const AQIReadings&)>;
+
+  static constexpr uint8_t MaxChannels = 4;
+  static constexpr uint32_t FreshWindow = 2500;       // ms
+  static constexpr uint32_t StaleAfter = 10 * 1000L;  // ms
+  static constexpr float DriftAbsolute = 5.0f;        // ug/m3
+  static constexpr float DriftRelative = 0.7f;
+  static constexpr float DriftSmoothing = 1.0f/60;    // About a minute of frames
+
+  struct Channel {
+    AQIReadings latest;
+    uint32_t frames;      // Frames delivered by this channel
+    float bias;           // Smoothed env PM2.5 difference from the other channels
+    float level;          // Smoothed env PM2.5 of all the channels
+    bool drifting;
+  };
+
+  explicit PMS5003Array(uint8_t nChannels = 1)
+      : nChannels(nChannels < MaxChannels ? nChannels : MaxChannels) { }
+
+  void setFrameHandler(FrameHandler handler) { frameHandler = handler; }
+
+  // Deliver a frame from the given channel
+  void add(uint8_t channel, const AQIReadings& r);
+
+  uint8_t size() const { return nChannels; }
+  const Channel& channel(uint8_t i) const { return channels[i]; }
+  bool isStale(uint8_t i, uint32_t now) const;
+
+  // A bit for each channel that is stale or drifting
+  uint8_t faults(uint32_t now) const;
+
+private:
+  uint8_t nChannels;
+  Channel channels[MaxChannels] = {};
+  FrameHandler frameHandler = nullptr;
+
+  uint8_t lead(uint32_t now) const;
+  void trackDrift(uint8_t fresh);
+};
+
+#endif  // PMS5003Array_h
@@ -0,0 +1,97 @@
+/*
+ * PMS5003DutyCycle
+ *    Sleeps the PMS5003 between samples and reads it in passive mode
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Local Includes
+#include "PMS5003DutyCycle.h"
+#include "PMS5003Parser.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  constexpr uint16_t Passive = 0, Active = 1;
+  constexpr uint16_t Sleep = 0, Wake = 1;
+}
+
+void PMS5003DutyCycle::begin(Stream** d, uint8_t n) {
+  devices = d;
+  nDevices = n;
+}
+
+void PMS5003DutyCycle::loop(uint32_t now) {
+  if (nDevices == 0) return;
+  bool cycling = interval >= MinSleepInterval;
+
+  switch (_state) {
+    case State::Continuous:
+      if (cycling) {
+        // Already awake and warm, so take this cycle's sample right away
+        send(ModeCommand, Passive);
+        cycleStart = now;
+        enter(State::Sampling, now);
+      }
+      break;
+
+    case State::Sleeping:
+      if (!cycling || now - cycleStart + WarmUp >= interval) {
+        send(SleepCommand, Wake);
+        enter(State::WarmingUp, now);
+      }
+      break;
+
+    case State::WarmingUp:
+      if (now - stateStart < WarmUp) break;
+      if (cycling) {
+        send(ModeCommand, Passive);
+        cycleStart = now;
+        enter(State::Sampling, now);
+      } else {
+        send(ModeCommand, Active);
+        enter(State::Continuous, now);
+      }
+      break;
+
+    case State::Sampling:
+      if (!cycling) {
+        send(ModeCommand, Active);
+        enter(State::Continuous, now);
+      } else if (now - lastRequest >= ReadPeriod) {
+        if (requests == SampleFrames) {
+          send(SleepCommand, Sleep);
+          enter(State::Sleeping, now);
+        } else {
+          send(ReadCommand, 0);
+          lastRequest = now;
+          requests++;
+        }
+      }
+      break;
+  }
+}
+
+void PMS5003DutyCycle::enter(State s, uint32_t now) {
+  bool sampleEnded = (_state == State::Sampling && s != State::Sampling);
+  _state = s;
+  stateStart = lastRequest = now;
+  requests = 0;
+  if (sampleEnded && sampleEndHandler) sampleEndHandler();
+}
+
+void PMS5003DutyCycle::send(uint8_t command, uint16_t data) {
+  uint8_t frame[CommandSize] = {
+    PMS5003Parser::Start1, PMS5003Parser::Start2, command,
+    (uint8_t)(data >> 8), (uint8_t)(data & 0xff), 0, 0 };
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < CommandSize - 2; i++) sum += frame[i];
+  frame[CommandSize - 2] = sum >> 8;
+  frame[CommandSize - 1] = sum & 0xff;
+
+  for (uint8_t i = 0; i < nDevices; i++) {
+    if (devices[i]) devices[i]->write(frame, CommandSize);
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ * PMS5003DutyCycle
+ *    Sleeps the PMS5003 between samples and reads it in passive mode
+ *
+ * NOTES:
+ * o Left alone, a PMS5003 runs its fan and laser continuously and sends a
+ *   frame every second. When readings are only wanted every few minutes
+ *   that is wasted serial processing and wasted sensor life (the laser is
+ *   rated for about 8000 hours).
+ * o setInterval() is given the interval at which readings are wanted (the
+ *   app's adaptive cadence). Below MinSleepInterval the sensor is kept
+ *   awake in active mode, streaming as it always has.
+ * o At or above MinSleepInterval each interval is a cycle: the sensor is
+ *   woken WarmUp before the sample is due so the fan can bring in fresh
+ *   air, put into passive mode, asked for SampleFrames frames at one second
+ *   spacing, and then put back to sleep. If the interval drops below
+ *   MinSleepInterval the sensor is woken (if need be), given its warm-up,
+ *   and returned to active mode.
+ * o Commands are 7-byte frames written to each sensor's serial device, so
+ *   the TX pin must be connected. The sensor acknowledges mode and sleep
+ *   commands with a short frame that PMS5003Parser skips.
+ * o The sample-end handler is called when the sensor leaves Sampling,
+ *   either to sleep or to stream again, so that the frames of the sample
+ *   can be summarized right away.
+ * o accepting() is false while the sensor is asleep or warming up. Frames
+ *   that arrive then (e.g. from a sensor that woke in active mode) should
+ *   be ignored, since they don't reflect the current air.
+ *
+ */
+
+#ifndef PMS5003DutyCycle_h
+#define PMS5003DutyCycle_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+#include <functional>
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class PMS5003DutyCycle {
+public:
+  static constexpr uint32_t WarmUp = 30 * 1000L;                // ms
+  static constexpr uint32_t ReadPeriod = 1000;                  // ms
+  static constexpr uint8_t  SampleFrames = 10;
+  static constexpr uint32_t MinSleepInterval = 2 * 60 * 1000L;  // ms
+
+  enum class State : uint8_t { Continuous, Sleeping, WarmingUp, Sampling };
+  using SampleEndHandler = std::function<void()>;
+
+  // The sensors' serial devices. Commands are sent to all of them.
+  void begin(Stream** devices, uint8_t nDevices);
+
+  // The interval at which readings are wanted, in ms
+  void setInterval(uint32_t ms) { interval = ms; }
+
+  void setSampleEndHandler(SampleEndHandler handler) { sampleEndHandler = handler; }
+
+  // Advances the cycle. Call frequently.
+  void loop(uint32_t now);
+
+  State state() const { return _state; }
+  bool accepting() const { return _state == State::Continuous || _state == State::Sampling; }
+
+private:
+  static constexpr uint8_t CommandSize = 7;
+  static constexpr uint8_t ReadCommand = 0xE2;
+  static constexpr uint8_t ModeCommand = 0xE1;    // Data 0 is passive, 1 is active
+  static constexpr uint8_t SleepCommand = 0xE4;   // Data 0 is sleep, 1 is wake
+
+  Stream** devices = nullptr;
+  uint8_t nDevices = 0;
+  uint32_t interval = 0;
+  State _state = State::Continuous;
+  uint32_t cycleStart = 0;    // When the latest sample began
+  uint32_t stateStart = 0;
+  uint32_t lastRequest = 0;
+  uint8_t requests = 0;
+  SampleEndHandler sampleEndHandler = nullptr;
+
+  void send(uint8_t command, uint16_t data);
+  void enter(State s, uint32_t now);
+};
+
+#endif  // PMS5003DutyCycle_h
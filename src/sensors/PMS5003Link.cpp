@@ -0,0 +1,47 @@
+/*
+ * PMS5003Link
+ *    Moves bytes from a PMS5003's serial device to the Stream AQIMgr reads
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Local Includes
+#include "PMS5003Link.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+void PMS5003Link::attach(Stream* d, bool drainsItself) {
+  device = d;
+  selfDraining = drainsItself;
+  sensorStream.setDevice(device);
+}
+
+// Runs in the context of whoever is producing bytes (e.g. the UART event
+// task on ESP32). It must not touch anything but the device and the ring.
+void PMS5003Link::drain() {
+  // Leave bytes in the driver rather than reading them with nowhere to go
+  while (device->available() && ring.available() < ring.capacity()) {
+    ring.push(device->read());
+  }
+}
+
+void PMS5003Link::loop() {
+  if (!device) return;
+  if (!selfDraining) drain();
+
+  uint8_t b;
+  while (ring.pop(b)) {
+    if (parser.consume(b, millis())) {
+      if (frameHandler) frameHandler(parser.readings());
+      else sensorStream.present(parser.readings());
+    }
+  }
+}
+
+PMS5003Link::Stats PMS5003Link::stats() const {
+  const PMS5003Parser::Stats& p = parser.stats();
+  return { p.framesAccepted, p.checksumErrors, p.syncErrors, p.resyncs,
+           ring.droppedBytes() + driverOverflows };
+}
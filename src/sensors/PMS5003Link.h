@@ -0,0 +1,76 @@
+/*
+ * PMS5003Link
+ *    Moves bytes from a PMS5003's serial device to the Stream AQIMgr reads
+ *
+ * NOTES:
+ * o drain() moves whatever the device has received into a ByteRing. It is
+ *   the producer side of the ring, so it may be called from a driver
+ *   callback while loop() runs in the main loop. If the device has no such
+ *   callback, loop() drains it first.
+ * o loop() runs the ring through a PMS5003Parser. Each valid frame goes to
+ *   the frame handler if one has been set, otherwise it is presented to the
+ *   SensorStream directly. A handler that wants AQIMgr to see something
+ *   calls present() itself.
+ * o Only the device's Stream interface is used, so the same code runs on
+ *   the host against a file or pipe (see tools/bench/PMSReplayBench.cpp).
+ *
+ */
+
+#ifndef PMS5003Link_h
+#define PMS5003Link_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+#include <functional>
+//                                  Local Includes
+#include "../util/ByteRing.h"
+#include "PMS5003Parser.h"
+#include "SensorStream.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class PMS5003Link {
+public:
+  using FrameHandler = std::function<void(const AQIReadings&)>;
+
+  struct Stats {
+    uint32_t framesAccepted;
+    uint32_t checksumErrors;
+    uint32_t syncErrors;
+    uint32_t resyncs;
+    uint32_t overflowBytes;   // Bytes lost because a buffer was full
+  };
+
+  static constexpr size_t RingSize = 256;
+
+  // selfDraining should be true if something other than loop() (e.g. a
+  // driver callback) will call drain()
+  void attach(Stream* device, bool selfDraining = false);
+
+  // The Stream to hand to AQIMgr
+  Stream* stream() { return &sensorStream; }
+
+  void setFrameHandler(FrameHandler handler) { frameHandler = handler; }
+  void present(const AQIReadings& r) { sensorStream.present(r); }
+
+  // ----- Producer side
+  void drain();
+  void countDriverOverflow() { driverOverflows++; }
+
+  // ----- Consumer side. Call frequently.
+  void loop();
+
+  Stats stats() const;
+
+private:
+  Stream* device = nullptr;
+  bool selfDraining = false;
+  ByteRing<RingSize> ring;
+  PMS5003Parser parser;
+  SensorStream sensorStream;
+  FrameHandler frameHandler = nullptr;
+  volatile uint32_t driverOverflows = 0;
+};
+
+#endif  // PMS5003Link_h
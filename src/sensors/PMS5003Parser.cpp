@@ -0,0 +1,120 @@
+/*
+ * PMS5003Parser
+ *    A byte-at-a-time state machine that recognizes PMS5003 frames
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Local Includes
+#include "PMS5003Parser.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+bool PMS5003Parser::consume(uint8_t b, uint32_t timestamp) {
+  if (skip) { skip--; return false; }
+  switch (pos) {
+    case 0:
+      if (b != Start1) { syncError(); return false; }
+      break;
+    case 1:
+      if (b != Start2) { syncError(); reset(b); return false; }
+      break;
+    case 2:
+    case 3:
+      word = (word << 8) | b;
+      if (pos == 3 && word == AckLength) { skip = AckLength; reset(b); return false; }
+      if (pos == 3 && word != FrameLength) { syncError(); reset(b); return false; }
+      break;
+    case ChecksumPos:
+      word = b;
+      pos++;
+      return false;
+    case ChecksumPos + 1: {
+      uint16_t checksum = (word << 8) | b;
+      pos = 0;
+      if (checksum != sum) { _stats.checksumErrors++; sum = 0; return false; }
+      sum = 0;
+      current ^= 1;
+      frames[current].timestamp = timestamp;
+      _stats.framesAccepted++;
+      inSync = true;
+      return true;
+    }
+    default:
+      word = (word << 8) | b;
+      if (pos & 1) setField(frames[current ^ 1], (pos - 4) / 2, word);
+      break;
+  }
+  sum += b;
+  pos++;
+  return false;
+}
+
+// Counts a byte that doesn't fit a frame. The first such byte after a valid
+// frame means the stream has lost sync and the parser is resynchronizing.
+void PMS5003Parser::syncError() {
+  _stats.syncErrors++;
+  if (inSync) { inSync = false; _stats.resyncs++; }
+}
+
+// Abandons the current frame. The byte that caused the problem may be the
+// start of the next frame.
+void PMS5003Parser::reset(uint8_t b) {
+  pos = 0;
+  sum = 0;
+  word = 0;
+  if (b == Start1) { sum = b; pos = 1; }
+}
+
+void PMS5003Parser::encode(const AQIReadings& r, uint8_t frame[FrameSize]) {
+  frame[0] = Start1;
+  frame[1] = Start2;
+  frame[2] = FrameLength >> 8;
+  frame[3] = FrameLength & 0xff;
+  for (uint8_t i = 0; i < 13; i++) {
+    uint16_t w = field(r, i);
+    frame[4 + 2*i] = w >> 8;
+    frame[5 + 2*i] = w & 0xff;
+  }
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < ChecksumPos; i++) sum += frame[i];
+  frame[ChecksumPos] = sum >> 8;
+  frame[ChecksumPos + 1] = sum & 0xff;
+}
+
+void PMS5003Parser::setField(AQIReadings& r, uint8_t index, uint16_t value) {
+  switch (index) {
+    case 0:  r.standard.pm10 = value; break;
+    case 1:  r.standard.pm25 = value; break;
+    case 2:  r.standard.pm100 = value; break;
+    case 3:  r.env.pm10 = value; break;
+    case 4:  r.env.pm25 = value; break;
+    case 5:  r.env.pm100 = value; break;
+    case 6:  r.particles_03um = value; break;
+    case 7:  r.particles_05um = value; break;
+    case 8:  r.particles_10um = value; break;
+    case 9:  r.particles_25um = value; break;
+    case 10: r.particles_50um = value; break;
+    case 11: r.particles_100um = value; break;
+    default: break;   // Reserved word
+  }
+}
+
+uint16_t PMS5003Parser::field(const AQIReadings& r, uint8_t index) {
+  switch (index) {
+    case 0:  return r.standard.pm10;
+    case 1:  return r.standard.pm25;
+    case 2:  return r.standard.pm100;
+    case 3:  return r.env.pm10;
+    case 4:  return r.env.pm25;
+    case 5:  return r.env.pm100;
+    case 6:  return r.particles_03um;
+    case 7:  return r.particles_05um;
+    case 8:  return r.particles_10um;
+    case 9:  return r.particles_25um;
+    case 10: return r.particles_50um;
+    case 11: return r.particles_100um;
+    default: return 0;  // Reserved word
+  }
+}
@@ -0,0 +1,83 @@
+/*
+ * PMS5003Parser
+ *    A byte-at-a-time state machine that recognizes PMS5003 frames
+ *
+ * NOTES:
+ * o A frame is 32 bytes: the start characters 0x42 0x4D, a 16-bit length
+ *   (always 28), 13 16-bit data words, and a 16-bit checksum which is the
+ *   sum of the preceding 30 bytes. All values are big-endian.
+ * o Frames are never buffered. Each data word is decoded directly into an
+ *   AQIReadings as its second byte arrives and the checksum is accumulated
+ *   along the way. When the checksum matches, the readings being filled
+ *   become the current readings and the other half of the double buffer is
+ *   used for the next frame. readings() returns a reference, not a copy.
+ * o The sensor answers mode and sleep commands with a short frame whose
+ *   length is 4. Its remaining bytes are skipped without counting errors.
+ * o After a bad length or checksum the parser looks for the next start
+ *   character, so it resynchronizes on its own after dropped bytes.
+ * o There are no Arduino dependencies beyond the AQIReadings type so this
+ *   may also be used in host builds.
+ *
+ */
+
+#ifndef PMS5003Parser_h
+#define PMS5003Parser_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  WebThing Includes
+#include <sensors/AQIMgr.h>
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class PMS5003Parser {
+public:
+  static constexpr uint8_t FrameSize = 32;
+  static constexpr uint8_t Start1 = 0x42;
+  static constexpr uint8_t Start2 = 0x4D;
+
+  struct Stats {
+    uint32_t framesAccepted;
+    uint32_t checksumErrors;
+    uint32_t syncErrors;      // Bytes discarded while looking for a frame, or bad lengths
+    uint32_t resyncs;         // Times the parser lost sync with the frames
+  };
+
+  // Processes one byte. Returns true if it completed a valid frame, in
+  // which case readings() holds the new values until the next valid frame.
+  // The timestamp of the readings is set to the supplied time.
+  bool consume(uint8_t b, uint32_t timestamp);
+
+  const AQIReadings& readings() const { return frames[current]; }
+  const Stats& stats() const { return _stats; }
+
+  // Produces the frame that a sensor would have sent for the given readings
+  static void encode(const AQIReadings& r, uint8_t frame[FrameSize]);
+
+  // Access to the values of a reading in frame order: standard pm10, pm25,
+  // pm100, env pm10, pm25, pm100, then the six particle counts
+  static constexpr uint8_t NFields = 12;
+  static void setField(AQIReadings& r, uint8_t index, uint16_t value);
+  static uint16_t field(const AQIReadings& r, uint8_t index);
+
+private:
+  static constexpr uint16_t FrameLength = FrameSize - 4;
+  static constexpr uint8_t ChecksumPos = FrameSize - 2;
+  static constexpr uint16_t AckLength = 4;
+
+  uint8_t pos = 0;          // Position in the frame of the next byte
+  uint8_t skip = 0;         // Bytes of a command acknowledgement still to skip
+  uint16_t sum = 0;         // Running checksum
+  uint16_t word = 0;        // The data word being assembled
+  uint8_t current = 0;      // Index of the last valid frame's readings
+  AQIReadings frames[2] = {};
+  Stats _stats = {0, 0, 0, 0};
+  bool inSync = true;
+
+  void reset(uint8_t b);
+  void syncError();
+};
+
+#endif  // PMS5003Parser_h
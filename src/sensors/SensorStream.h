@@ -0,0 +1,64 @@
+/*
+ * SensorStream
+ *    The Stream that AQIMgr reads PMS5003 frames from
+ *
+ * NOTES:
+ * o AQIMgr expects to read raw PMS5003 frames from a Stream. Rather than
+ *   giving it the UART, the app gives it a SensorStream which only ever
+ *   contains frames the app has chosen to present(). Each is a freshly
+ *   encoded, valid frame, so AQIMgr never sees partial or corrupt data and
+ *   is never the thing responsible for draining the UART.
+ * o If a new frame is presented before AQIMgr has read the previous one,
+ *   the previous one is discarded. AQIMgr only cares about the latest.
+ * o Presented readings are parsed twice: once from the UART by the app and
+ *   again, from this stream, by AQIMgr. AQIMgr has no way to be handed
+ *   AQIReadings directly (its parsing and state are private to WebThing)
+ *   so the readings have to go through a Stream. The second parse only
+ *   happens for the readings the app presents, one per aggregation
+ *   interval rather than one per frame, and the round trip costs about
+ *   0.2 us on the host (see tools/bench/PMSReplayBench.cpp).
+ * o Anything AQIMgr writes (e.g. sensor commands) is passed through to the
+ *   underlying device, if any.
+ *
+ */
+
+#ifndef SensorStream_h
+#define SensorStream_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Local Includes
+#include "PMS5003Parser.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class SensorStream : public Stream {
+public:
+  void setDevice(Stream* d) { device = d; }
+
+  void present(const AQIReadings& r) {
+    PMS5003Parser::encode(r, frame);
+    pos = 0;
+  }
+
+  // ----- Stream
+  virtual int available() override { return PMS5003Parser::FrameSize - pos; }
+  virtual int read() override {
+    return (pos < PMS5003Parser::FrameSize) ? frame[pos++] : -1;
+  }
+  virtual int peek() override {
+    return (pos < PMS5003Parser::FrameSize) ? frame[pos] : -1;
+  }
+  virtual void flush() override { }
+
+  // ----- Print
+  virtual size_t write(uint8_t b) override { return device ? device->write(b) : 0; }
+
+private:
+  Stream* device = nullptr;
+  uint8_t frame[PMS5003Parser::FrameSize];
+  uint8_t pos = PMS5003Parser::FrameSize;   // Nothing to read yet
+};
+
+#endif  // SensorStream_h
@@ -0,0 +1,65 @@
+/*
+ * ByteRing
+ *    A fixed-size, single-producer/single-consumer ring of bytes
+ *
+ * NOTES:
+ * o One context (an ISR or a driver callback) may push() while another (the
+ *   main loop) pops. No locking is needed as long as there is only one of
+ *   each. The producer only writes head and the consumer only writes tail.
+ * o head and tail are free-running counters. Their difference is the number
+ *   of bytes in the ring, which is why the size must be a power of 2.
+ * o When the ring is full, incoming bytes are dropped and counted rather
+ *   than overwriting bytes the consumer hasn't seen.
+ * o There are no Arduino dependencies so this may also be used in host builds.
+ *
+ */
+
+#ifndef ByteRing_h
+#define ByteRing_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stddef.h>
+#include <stdint.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+template<size_t N>
+class ByteRing {
+  static_assert(N && (N & (N - 1)) == 0, "ByteRing size must be a power of 2");
+
+public:
+  // ----- Producer side
+  bool push(uint8_t b) {
+    uint32_t h = head;
+    if (h - tail == N) { dropped++; return false; }
+    buf[h & (N - 1)] = b;
+    __sync_synchronize();   // The byte must be visible before the new head
+    head = h + 1;
+    return true;
+  }
+
+  // ----- Consumer side
+  bool pop(uint8_t& b) {
+    uint32_t t = tail;
+    if (t == head) return false;
+    __sync_synchronize();
+    b = buf[t & (N - 1)];
+    tail = t + 1;
+    return true;
+  }
+
+  size_t available() const { return head - tail; }
+  uint32_t droppedBytes() const { return dropped; }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  uint8_t buf[N];
+  volatile uint32_t head = 0;
+  volatile uint32_t tail = 0;
+  volatile uint32_t dropped = 0;
+};
+
+#endif  // ByteRing_h
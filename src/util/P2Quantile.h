@@ -0,0 +1,102 @@
+/*
+ * P2Quantile
+ *    Streaming quantile estimation in constant space using the P² algorithm
+ *    (Jain & Chlamtac, "The P² Algorithm for Dynamic Calculation of
+ *    Quantiles and Histograms Without Storing Observations", CACM 1985)
+ *
+ * NOTES:
+ * o Five markers track the minimum, the maximum, the desired quantile and
+ *   the quantiles halfway to either side. As each observation arrives the
+ *   markers are nudged toward their ideal positions using a piecewise
+ *   parabolic fit. Memory and time per observation are constant.
+ * o Until five observations have been seen the exact quantile of the
+ *   observations is returned.
+ * o There are no Arduino dependencies so this may also be used in host builds.
+ *
+ */
+
+#ifndef P2Quantile_h
+#define P2Quantile_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class P2Quantile {
+public:
+  explicit P2Quantile(float p = 0.5f) : p(p) { reset(); }
+
+  void reset() { count = 0; }
+
+  void add(float x) {
+    if (count < 5) {
+      // Keep the first observations sorted in q
+      int i = count++;
+      while (i > 0 && q[i-1] > x) { q[i] = q[i-1]; i--; }
+      q[i] = x;
+      if (count == 5) {
+        for (int j = 0; j < 5; j++) n[j] = j;
+        np[0] = 0; np[1] = 2*p; np[2] = 4*p; np[3] = 2 + 2*p; np[4] = 4;
+      }
+      return;
+    }
+
+    // Find the cell containing x, extending the extremes if need be
+    int k;
+    if (x < q[0]) { q[0] = x; k = 0; }
+    else if (x >= q[4]) { q[4] = x; k = 3; }
+    else { k = 0; while (x >= q[k+1]) k++; }
+
+    for (int i = k + 1; i < 5; i++) n[i]++;
+    const float dn[5] = {0, p/2, p, (1+p)/2, 1};
+    for (int i = 0; i < 5; i++) np[i] += dn[i];
+    count++;
+
+    // Adjust the middle markers if they are off by a position or more
+    for (int i = 1; i <= 3; i++) {
+      float d = np[i] - n[i];
+      if ((d >= 1 && n[i+1] - n[i] > 1) || (d <= -1 && n[i-1] - n[i] < -1)) {
+        int s = (d >= 0) ? 1 : -1;
+        float candidate = parabolic(i, s);
+        if (q[i-1] < candidate && candidate < q[i+1]) q[i] = candidate;
+        else q[i] = linear(i, s);
+        n[i] += s;
+      }
+    }
+  }
+
+  float value() const {
+    if (count >= 5) return q[2];
+    if (count == 0) return 0;
+    // Exact quantile of the sorted observations seen so far
+    float pos = p * (count - 1);
+    int lo = (int)pos;
+    if (lo >= (int)count - 1) return q[count-1];
+    return q[lo] + (pos - lo) * (q[lo+1] - q[lo]);
+  }
+
+  uint32_t observations() const { return count; }
+
+private:
+  float p;
+  uint32_t count;
+  float q[5];     // Marker heights
+  int32_t n[5];   // Marker positions
+  float np[5];    // Desired marker positions
+
+  float parabolic(int i, int s) const {
+    return q[i] + (float)s / (n[i+1] - n[i-1]) * (
+      (n[i] - n[i-1] + s) * (q[i+1] - q[i]) / (n[i+1] - n[i]) +
+      (n[i+1] - n[i] - s) * (q[i] - q[i-1]) / (n[i] - n[i-1]));
+  }
+
+  float linear(int i, int s) const {
+    return q[i] + s * (q[i+s] - q[i]) / (n[i+s] - n[i]);
+  }
+};
+
+#endif  // P2Quantile_h
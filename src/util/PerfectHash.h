@@ -0,0 +1,144 @@
+/*
+ * PerfectHash
+ *    Compile-time perfect hashing for small, fixed sets of string keys
+ *
+ * NOTES:
+ * o A Table is built from an array of entries, each of which has a 'key'
+ *   member (a C string) plus whatever payload the user wants to associate
+ *   with it. Keys are hashed with FNV-1a (the seed is used as the offset
+ *   basis) and reduced modulo a power-of-two slot count. The slot -> entry
+ *   map is computed by the compiler.
+ * o Callers should static_assert(table.isPerfect(), ...). If it fails, pick
+ *   a different seed or a larger slot count. Once it holds, every lookup is
+ *   one hash, one slot load, and one string compare, no matter which key is
+ *   being requested.
+ * o Everything here is C++11 constexpr (single return statements) since the
+ *   ESP32 toolchain still compiles with -std=gnu++11.
+ * o A Table and its entries may be placed in PROGMEM. Lookups read them
+ *   with pgm_read_* and compare keys with strcmp_P, and find() copies the
+ *   matching entry out to the caller. For this to work, each entry must hold
+ *   its key as a char array rather than a pointer to a string literal, so
+ *   the key text is stored with the entry.
+ * o Outside of Arduino builds the pgmspace functions are plain loads, so
+ *   this may also be used in host builds.
+ *
+ */
+
+#ifndef PerfectHash_h
+#define PerfectHash_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#if defined(ARDUINO)
+  #include <pgmspace.h>
+#else
+  #define PROGMEM
+  #define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+  #define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+  #define pgm_read_ptr(addr) (*(const void* const*)(addr))
+  #define memcpy_P memcpy
+  #define strcmp_P strcmp
+#endif
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace PerfectHash {
+  constexpr uint32_t FNVOffset = 2166136261u;
+  constexpr uint32_t FNVPrime = 16777619u;
+
+  // Compile-time version of the hash
+  constexpr uint32_t hash(const char* s, uint32_t h = FNVOffset) {
+    return *s ? hash(s + 1, (h ^ (uint8_t)*s) * FNVPrime) : h;
+  }
+
+  // Run-time version of the hash. Must produce the same result as hash().
+  inline uint32_t runtimeHash(const char* s, uint32_t h = FNVOffset) {
+    while (*s) { h = (h ^ (uint8_t)*s++) * FNVPrime; }
+    return h;
+  }
+
+  // The low bits of FNV-1a are poorly mixed for short keys. Fold the high
+  // half in before masking down to a slot index.
+  constexpr uint32_t fold(uint32_t h) { return h ^ (h >> 16); }
+
+  // ----- C++11 stand-ins for std::index_sequence
+  template <size_t... I> struct Indices { };
+  template <size_t N, size_t... I> struct MakeIndices : MakeIndices<N-1, N-1, I...> { };
+  template <size_t... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+  template <typename Entry, size_t NEntries, size_t NSlots>
+  class Table {
+  public:
+    static_assert((NSlots & (NSlots-1)) == 0, "NSlots must be a power of two");
+    static_assert(NEntries < 128 && NEntries <= NSlots, "Too many entries");
+    static_assert(std::is_array<decltype(Entry::key)>::value, "Entry::key must be a char array");
+
+    constexpr Table(const Entry (&e)[NEntries], uint32_t seed = FNVOffset)
+        : Table(e, seed, typename MakeIndices<NSlots>::type()) { }
+
+    // True if no two keys share a slot
+    constexpr bool isPerfect() const { return ownsAll(0); }
+
+    // Returns the index of the entry for the given key, or -1 if there isn't one
+    int indexOf(const char* key) const {
+      uint32_t h = fold(runtimeHash(key, pgm_read_dword(&seed)));
+      int8_t i = (int8_t)pgm_read_byte(&slots[h & (NSlots-1)]);
+      if (i < 0 || strcmp_P(key, entryAt(i)->key) != 0) return -1;
+      return i;
+    }
+
+    // Copies the entry for the given key into entry. Returns false, leaving
+    // entry untouched, if there isn't one.
+    bool find(const char* key, Entry& entry) const {
+      int i = indexOf(key);
+      if (i < 0) return false;
+      memcpy_P(&entry, entryAt(i), sizeof(Entry));
+      return true;
+    }
+
+  private:
+    const Entry* entries;
+    uint32_t seed;
+    int8_t slots[NSlots];
+
+    template <size_t... S>
+    constexpr Table(const Entry (&e)[NEntries], uint32_t seed, Indices<S...>)
+        : entries(e), seed(seed), slots{ ownerOf(e, seed, S, 0)... } { }
+
+    const Entry* entryAt(int i) const {
+      return static_cast<const Entry*>(pgm_read_ptr(&entries)) + i;
+    }
+
+    static constexpr size_t slotOf(const char* key, uint32_t seed) {
+      return fold(hash(key, seed)) & (NSlots-1);
+    }
+
+    // The first entry (starting at i) that hashes to slot, or -1
+    static constexpr int8_t ownerOf(
+        const Entry (&e)[NEntries], uint32_t seed, size_t slot, size_t i) {
+      return (i == NEntries) ? -1 :
+             (slotOf(e[i].key, seed) == slot) ? (int8_t)i : ownerOf(e, seed, slot, i+1);
+    }
+
+    // Every entry from i onward is the owner of its own slot (no collisions)
+    constexpr bool ownsAll(size_t i) const {
+      return (i == NEntries) ||
+             (slots[slotOf(entries[i].key, seed)] == (int8_t)i && ownsAll(i+1));
+    }
+  };
+
+  // Convenience function so callers don't have to spell out the template arguments
+  template <size_t NSlots, typename Entry, size_t NEntries>
+  constexpr Table<Entry, NEntries, NSlots> makeTable(
+      const Entry (&e)[NEntries], uint32_t seed = FNVOffset) {
+    return Table<Entry, NEntries, NSlots>(e, seed);
+  }
+}
+
+#endif  // PerfectHash_h
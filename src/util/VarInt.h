@@ -0,0 +1,46 @@
+/*
+ * VarInt
+ *    LEB128-style variable length integers with zigzag encoding for signed
+ *    values
+ *
+ * NOTES:
+ * o Each byte carries 7 bits of the value, least significant group first.
+ *   The high bit is set on every byte except the last. Values below 128
+ *   take one byte and a uint32_t never takes more than MaxBytes.
+ * o zigzag() maps signed values to unsigned ones so that small magnitudes
+ *   stay small: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+ * o There are no Arduino dependencies so this may also be used in host builds.
+ *
+ */
+
+#ifndef VarInt_h
+#define VarInt_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stddef.h>
+#include <stdint.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace VarInt {
+  constexpr size_t MaxBytes = 5;
+
+  inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+  inline int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+  // Encodes v into out, which must have room for MaxBytes. Returns the
+  // number of bytes written.
+  inline size_t put(uint8_t* out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) { out[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+    out[n++] = (uint8_t)v;
+    return n;
+  }
+
+  inline size_t putSigned(uint8_t* out, int32_t v) { return put(out, zigzag(v)); }
+}
+
+#endif  // VarInt_h
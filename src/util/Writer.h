@@ -0,0 +1,126 @@
+/*
+ * Writer
+ *    Formats text into a caller-provided, fixed-size buffer
+ *
+ * NOTES:
+ * o A Writer never allocates. Text is appended to the buffer supplied by
+ *   the caller. If a FlushFn is supplied, the buffer is handed to it
+ *   whenever it fills, so arbitrarily long output can be produced in
+ *   chunks. Without a FlushFn, output that doesn't fit is dropped and
+ *   overflowed() returns true.
+ * o Numbers are formatted with integer arithmetic only. Floating point
+ *   values are scaled to a fixed number of decimals and then printed as
+ *   integers, which avoids the temporaries created by String(float, n).
+ * o There are no Arduino dependencies so this may also be used in host
+ *   builds. When building for Arduino, Strings may be printed directly.
+ *
+ */
+
+#ifndef Writer_h
+#define Writer_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(ARDUINO)
+  #include <WString.h>
+#endif
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class Writer {
+public:
+  using FlushFn = void (*)(const char* data, size_t len);
+
+  // The buffer must have room for at least 2 bytes. One byte is always
+  // reserved for a terminating NUL.
+  Writer(char* buf, size_t size, FlushFn flushFn = nullptr)
+      : buf(buf), capacity(size - 1), flushFn(flushFn) { buf[0] = '\0'; }
+
+  Writer& write(const char* data, size_t len) {
+    while (len) {
+      size_t room = capacity - used;
+      if (room == 0) {
+        if (!flushFn) { truncated = true; break; }
+        flush();
+        continue;
+      }
+      size_t n = (len < room) ? len : room;
+      memcpy(buf + used, data, n);
+      used += n; data += n; len -= n;
+    }
+    buf[used] = '\0';
+    return *this;
+  }
+
+  Writer& print(const char* s) { return s ? write(s, strlen(s)) : *this; }
+  Writer& print(char c) { return write(&c, 1); }
+#if defined(ARDUINO)
+  Writer& print(const String& s) { return write(s.c_str(), s.length()); }
+#endif
+
+  Writer& printUInt(uint32_t v) {
+    char out[10];
+    uint8_t i = sizeof(out);
+    do { out[--i] = '0' + (v % 10); v /= 10; } while (v);
+    return write(out + i, sizeof(out) - i);
+  }
+
+  Writer& printInt(int32_t v) {
+    if (v < 0) { print('-'); return printUInt(0u - (uint32_t)v); }
+    return printUInt(v);
+  }
+
+  // Prints scaled/(10^decimals), e.g. printFixed(-1234, 2) prints "-12.34"
+  Writer& printFixed(int32_t scaled, uint8_t decimals) {
+    if (decimals == 0) return printInt(scaled);
+    uint32_t magnitude = (scaled < 0) ? (0u - (uint32_t)scaled) : scaled;
+    uint32_t divisor = pow10(decimals);
+    if (scaled < 0) print('-');
+    printUInt(magnitude / divisor);
+    print('.');
+    uint32_t frac = magnitude % divisor;
+    char out[9];
+    for (int i = decimals - 1; i >= 0; i--) { out[i] = '0' + (frac % 10); frac /= 10; }
+    return write(out, decimals);
+  }
+
+  // Rounds v to the given number of decimals (at most 8) and prints it.
+  // The caller is responsible for checking for NaN.
+  Writer& printFloat(float v, uint8_t decimals) {
+    float scaled = v * pow10(decimals);
+    return printFixed((int32_t)(scaled + ((scaled < 0) ? -0.5f : 0.5f)), decimals);
+  }
+
+  // Hands any buffered output to the FlushFn and empties the buffer
+  void flush() {
+    if (flushFn && used) flushFn(buf, used);
+    used = 0;
+    buf[0] = '\0';
+  }
+
+  void clear() { used = 0; buf[0] = '\0'; truncated = false; }
+
+  const char* c_str() const { return buf; }
+  size_t length() const { return used; }
+  bool overflowed() const { return truncated; }
+
+private:
+  char* buf;
+  size_t capacity;
+  size_t used = 0;
+  FlushFn flushFn;
+  bool truncated = false;
+
+  static uint32_t pow10(uint8_t n) {
+    uint32_t p = 1;
+    while (n--) p *= 10;
+    return p;
+  }
+};
+
+#endif  // Writer_h
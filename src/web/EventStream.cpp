@@ -0,0 +1,187 @@
+/*
+ * EventStream
+ *    A minimal Server-Sent Events server
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+#if defined(ESP32)
+  #include <lwip/sockets.h>
+#endif
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "../util/Writer.h"
+#include "EventStream.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  const char RequestPrefix[] = "GET /events";
+  const char HeaderTerminator[] = "\r\n\r\n";
+
+  const char StreamHeader[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n"
+    "retry: 5000\n\n";
+
+  const char NotFound[] =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+  const char KeepAlive[] = ":\n\n";
+
+  // The number of bytes that can be written to conn without blocking
+  size_t writeRoom(WiFiClient& conn, size_t wanted) {
+    #if defined(ESP32)
+      // The ESP32's WiFiClient doesn't report its free send buffer space.
+      // lwIP only reports a socket as writable once more than TCP_SNDLOWAT
+      // bytes are free, which is well over MaxMessageSize.
+      int fd = conn.fd();
+      if (fd < 0) return 0;
+      fd_set writable;
+      FD_ZERO(&writable);
+      FD_SET(fd, &writable);
+      timeval noWait = {0, 0};
+      return (select(fd + 1, nullptr, &writable, nullptr, &noWait) > 0) ? wanted : 0;
+    #else
+      (void)wanted; // Avoid compiler warning
+      return conn.availableForWrite();
+    #endif
+  }
+}
+
+void EventStream::begin(uint16_t port) {
+  _port = port;
+  server = new WiFiServer(port);
+  server->begin();
+  server->setNoDelay(true);
+  Log.verbose(F("EventStream::begin: listening on port %d"), port);
+}
+
+void EventStream::loop() {
+  if (!server) return;
+  accept();
+
+  bool idle = (millis() - lastWrite) > KeepAliveInterval;
+  for (Client& c : clients) {
+    switch (c.state) {
+      case State::Unused: break;
+      case State::Reading:
+        readRequest(c);
+        break;
+      case State::Streaming:
+        if (!c.conn.connected()) drop(c);
+        else if (idle) send(c, KeepAlive, sizeof(KeepAlive)-1);
+        break;
+    }
+  }
+  if (idle) lastWrite = millis();
+}
+
+bool EventStream::publish(const char* event, const char* data) {
+  Writer out(message, sizeof(message));
+  out.print("event: ").print(event).print("\ndata: ").print(data).print("\n\n");
+  if (out.overflowed()) {
+    Log.warning(F("EventStream::publish: %s event is too large"), event);
+    messageLength = 0;
+    return false;
+  }
+  messageLength = out.length();
+
+  for (Client& c : clients) {
+    if (c.state == State::Streaming) send(c, message, messageLength);
+  }
+  lastWrite = millis();
+  return true;
+}
+
+uint8_t EventStream::clientCount() const {
+  uint8_t count = 0;
+  for (const Client& c : clients) { if (c.state == State::Streaming) count++; }
+  return count;
+}
+
+void EventStream::accept() {
+  WiFiClient incoming = server->available();
+  if (!incoming) return;
+
+  for (Client& c : clients) {
+    if (c.state == State::Unused) {
+      c.conn = incoming;
+      c.state = State::Reading;
+      c.valid = true;
+      c.prefixPos = 0;
+      c.endPos = 0;
+      c.connectedAt = millis();
+      return;
+    }
+  }
+  // No room for another client
+  incoming.write((const uint8_t*)NotFound, sizeof(NotFound)-1);
+  incoming.stop();
+}
+
+// Consumes whatever part of the request has arrived without blocking. Once
+// the headers are complete, the client either starts streaming or is
+// turned away.
+void EventStream::readRequest(Client& c) {
+  while (c.conn.available()) {
+    char ch = c.conn.read();
+    if (c.prefixPos < sizeof(RequestPrefix)-1) {
+      if (ch != RequestPrefix[c.prefixPos++]) c.valid = false;
+    }
+    if (ch == HeaderTerminator[c.endPos]) c.endPos++;
+    else c.endPos = (ch == '\r') ? 1 : 0;
+
+    if (c.endPos == sizeof(HeaderTerminator)-1) {
+      if (!c.valid) {
+        c.conn.write((const uint8_t*)NotFound, sizeof(NotFound)-1);
+        drop(c);
+        return;
+      }
+      c.skipped = 0;
+      if (!send(c, StreamHeader, sizeof(StreamHeader)-1)) {
+        drop(c);
+        return;
+      }
+      c.state = State::Streaming;
+      if (messageLength) send(c, message, messageLength);
+      return;
+    }
+  }
+
+  if (millis() - c.connectedAt > RequestTimeout) drop(c);
+}
+
+// Writes data only if all of it fits in the client's send buffer, so a slow
+// client never blocks the loop. Messages are skipped whole rather than
+// truncated, and a client that misses MaxSkipped in a row is dropped.
+bool EventStream::send(Client& c, const char* data, size_t len) {
+  if (writeRoom(c.conn, len) < len) {
+    if (++c.skipped > MaxSkipped) {
+      Log.verbose(F("EventStream::send: dropping a client that isn't reading"));
+      drop(c);
+    }
+    return false;
+  }
+  c.skipped = 0;
+  if (c.conn.write((const uint8_t*)data, len) != len) {
+    drop(c);
+    return false;
+  }
+  return true;
+}
+
+void EventStream::drop(Client& c) {
+  c.conn.stop();
+  c.state = State::Unused;
+}
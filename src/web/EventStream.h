@@ -0,0 +1,88 @@
+/*
+ * EventStream
+ *    A minimal Server-Sent Events server
+ *
+ * NOTES:
+ * o The WebUI's web server handles one request at a time and closes the
+ *   connection when the handler returns, so it can't hold an event stream
+ *   open. EventStream runs its own small server on a separate port. It only
+ *   answers "GET /events"; anything else gets a 404.
+ * o Responses include "Access-Control-Allow-Origin: *" so that pages served
+ *   by the WebUI (on port 80) may connect.
+ * o publish() formats the event once into an internal buffer and writes the
+ *   same bytes to every connected client. The most recent event is also sent
+ *   to each client as soon as it connects.
+ * o Writes never block. A message is only written to a client whose send
+ *   buffer has room for all of it; otherwise that client skips the message.
+ *   A client that skips several messages in a row, or whose write fails, is
+ *   dropped. A comment line is sent periodically when there is no other
+ *   traffic so that dead connections are noticed.
+ *
+ */
+
+#ifndef EventStream_h
+#define EventStream_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+#if defined(ESP8266)
+  #include <ESP8266WiFi.h>
+#elif defined(ESP32)
+  #include <WiFi.h>
+#endif
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class EventStream {
+public:
+  static constexpr uint16_t DefaultPort = 8081;
+  static constexpr uint8_t  MaxClients = 4;
+  static constexpr size_t   MaxMessageSize = 768;
+
+  void begin(uint16_t port = DefaultPort);
+
+  // Accepts new clients, reads their requests, and sends keep-alives.
+  // Call this frequently.
+  void loop();
+
+  // Sends an event to every connected client. data must be a single line.
+  // Returns false if the event was too large to send.
+  bool publish(const char* event, const char* data);
+
+  uint8_t clientCount() const;
+  uint16_t port() const { return _port; }
+
+private:
+  static constexpr uint32_t RequestTimeout = 2 * 1000L;
+  static constexpr uint32_t KeepAliveInterval = 15 * 1000L;
+  static constexpr uint8_t  MaxSkipped = 3;
+
+  enum class State : uint8_t { Unused, Reading, Streaming };
+
+  struct Client {
+    WiFiClient conn;
+    State state = State::Unused;
+    bool valid;           // Request line matched "GET /events" so far
+    uint8_t prefixPos;    // Characters of the request prefix seen so far
+    uint8_t endPos;       // Characters of the header terminator seen so far
+    uint8_t skipped;      // Consecutive messages skipped for lack of room
+    uint32_t connectedAt;
+  };
+
+  WiFiServer* server = nullptr;
+  uint16_t _port = 0;
+  Client clients[MaxClients];
+  char message[MaxMessageSize];
+  size_t messageLength = 0;
+  uint32_t lastWrite = 0;
+
+  void accept();
+  void readRequest(Client& c);
+  bool send(Client& c, const char* data, size_t len);
+  void drop(Client& c);
+};
+
+#endif  // EventStream_h
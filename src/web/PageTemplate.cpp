@@ -0,0 +1,111 @@
+/*
+ * PageTemplate
+ *    An HTML template that is parsed once and then rendered many times
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  WebThing Includes
+#include <ESP_FS.h>
+#include <WebUI.h>
+//                                  Local Includes
+#include "PageTemplate.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  char chunkBuf[PageTemplate::ChunkSize];
+  String chunk;   // Reserved once and reused so sending never allocates
+
+  void sendChunk(const char* data, size_t len) {
+    chunk.remove(0);
+    chunk.concat(data, len);
+    WebUI::sendContent(chunk);
+  }
+}
+
+bool PageTemplate::compile(const char* thePath, Resolver resolver) {
+  path = thePath;
+  segments.clear();
+  if (chunk.length() == 0) chunk.reserve(ChunkSize);
+  compiled = false;
+
+  File f = ESP_FS::open(path, "r");
+  if (!f) {
+    Log.warning(F("PageTemplate::compile: Unable to open %s"), path);
+    return false;
+  }
+
+  uint32_t literalStart = 0;
+  char key[MaxKeyLength+1];
+  while (f.available()) {
+    uint32_t pos = f.position();
+    int c = f.read();
+    if (c == '\\') {
+      // The escaped character starts the next literal range
+      addSegment(literalStart, pos, NoValue);
+      literalStart = pos + 1;
+      if (f.available()) f.read();
+    } else if (c == '%') {
+      size_t len = 0;
+      int k = f.read();
+      while (k != -1 && k != '%' && len < MaxKeyLength) { key[len++] = k; k = f.read(); }
+      if (k != '%') {
+        // Not a placeholder. Treat the '%' as a literal and keep scanning after it
+        f.seek(pos + 1);
+        continue;
+      }
+      key[len] = '\0';
+      addSegment(literalStart, pos, resolver(key));
+      literalStart = f.position();
+    }
+  }
+  addSegment(literalStart, f.size(), NoValue);
+  f.close();
+
+  segments.shrink_to_fit();
+  compiled = true;
+  Log.verbose(F("PageTemplate::compile: %s -> %d segments"), path, segments.size());
+  return true;
+}
+
+void PageTemplate::render(ValueFn valueFn) {
+  uint32_t start = micros();
+
+  File f = ESP_FS::open(path, "r");
+  if (!f) {
+    Log.warning(F("PageTemplate::render: Unable to open %s"), path);
+    return;
+  }
+
+  Writer out(chunkBuf, ChunkSize, sendChunk);
+  char buf[128];
+  for (const Segment& s : segments) {
+    if (s.length) {
+      f.seek(s.offset);
+      size_t remaining = s.length;
+      while (remaining) {
+        size_t n = f.read((uint8_t*)buf, std::min(remaining, sizeof(buf)));
+        if (n == 0) break;
+        out.write(buf, n);
+        remaining -= n;
+      }
+    }
+    if (s.value != NoValue) valueFn(s.value, out);
+  }
+  out.flush();
+  f.close();
+
+  renderMicros = micros() - start;
+  Log.verbose(F("PageTemplate::render: %s took %d us"), path, renderMicros);
+}
+
+void PageTemplate::addSegment(uint32_t offset, uint32_t end, uint8_t value) {
+  uint16_t length = end - offset;
+  if (length == 0 && value == NoValue) return;
+  segments.push_back({(uint16_t)offset, length, value});
+}
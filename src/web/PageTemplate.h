@@ -0,0 +1,69 @@
+/*
+ * PageTemplate
+ *    An HTML template that is parsed once and then rendered many times
+ *
+ * NOTES:
+ * o Uses the same syntax as ESPTemplateProcessor: %KEY% is a placeholder and
+ *   a backslash causes the following character to be emitted literally.
+ * o compile() scans the template file once (at boot) and turns it into a list
+ *   of segments. Each segment is a literal byte range of the file followed by
+ *   an optional value ID. The ID is obtained from the supplied Resolver, so
+ *   key strings are only ever compared during compile().
+ * o render() walks the segment list in order, copying literal ranges from
+ *   the file and asking the ValueFn for each pre-resolved ID. There is no
+ *   scanning for '%' and no key lookups.
+ * o Output is assembled in a static chunk buffer by a Writer and sent with
+ *   WebUI::sendContent() through a String that is reserved once, so there
+ *   are no allocations per value or per chunk. Opening the template file
+ *   for each render does allocate a file handle; PageRenderBench counts one
+ *   allocation per render on the host against ~80-120 for the old path.
+ *
+ */
+
+#ifndef PageTemplate_h
+#define PageTemplate_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+#include <vector>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "../util/Writer.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class PageTemplate {
+public:
+  static constexpr uint8_t NoValue = 0xff;
+  static constexpr size_t ChunkSize = 1024;
+
+  // Maps a key to a value ID, or NoValue if the key is unknown
+  using Resolver = uint8_t (*)(const char* key);
+  // Writes the value with the given ID to out
+  using ValueFn = void (*)(uint8_t id, Writer& out);
+
+  bool compile(const char* path, Resolver resolver);
+  void render(ValueFn valueFn);
+
+  bool isCompiled() const { return compiled; }
+  uint32_t lastRenderTime() const { return renderMicros; }
+
+private:
+  static constexpr size_t MaxKeyLength = 32;
+
+  struct Segment {
+    uint16_t offset;    // Start of the literal range in the file
+    uint16_t length;    // Length of the literal range (may be 0)
+    uint8_t  value;     // ID of the value that follows the range, or NoValue
+  };
+
+  const char* path = nullptr;
+  std::vector<Segment> segments;
+  bool compiled = false;
+  uint32_t renderMicros = 0;
+
+  void addSegment(uint32_t offset, uint32_t end, uint8_t value);
+};
+
+#endif  // PageTemplate_h
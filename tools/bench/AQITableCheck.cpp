@@ -0,0 +1,71 @@
+/*
+ * AQITableCheck
+ *    Host-side check that the compile-time table behind DerivedAQI::aqiForPM25
+ *    gives the same AQI as the run-time calculation it replaced
+ *
+ * NOTES:
+ * o This is not part of the sketch. Build and run it on the host with:
+ *     g++ -std=c++11 -O2 -Itools/bench/host -o /tmp/AQITableCheck tools/bench/AQITableCheck.cpp src/data/DerivedAQI.cpp
+ *     /tmp/AQITableCheck
+ * o AQIMgr itself is part of WebThingApp and isn't available on the host.
+ *   Its derivedAQI() walks the same table as calcAQI() in ChartPage.html,
+ *   so that walk is transliterated below and used as the reference.
+ * o Every whole ug/m3 from 0 to 600 is compared. The two agree up to
+ *   250 ug/m3. Above that the reference returns 500 because its search
+ *   runs off the end of the table, whereas the table interpolates the last
+ *   breakpoint (301-500) and saturates at 500 only past 500 ug/m3. That
+ *   difference is intended and is reported separately from mismatches.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+#include <stdio.h>
+//                                  Local Includes
+#include "../../src/data/DerivedAQI.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+// ----- The original calculation, transliterated
+static uint16_t referenceAQI(uint16_t reading) {
+  static const struct { float pMin, pRange; uint16_t aqMin, aqRange; } AQITable[] = {
+    {  0.0f,  15.4f,   0,  50},
+    { 15.5f,  24.9f,  51,  49},
+    { 40.5f,  24.9f, 101,  49},
+    { 65.5f,  84.9f, 151,  49},
+    {150.5f,  99.9f, 201,  99},
+    {250.5f, 249.9f, 301, 199}
+  };
+  constexpr int NEntries = sizeof(AQITable)/sizeof(AQITable[0]);
+
+  int i;
+  for (i = 0; i < NEntries; i++) {
+    if (reading < AQITable[i].pMin) break;
+  }
+  if (i == NEntries) return 500;
+  i--;
+  float aqi = ((reading - AQITable[i].pMin) * AQITable[i].aqRange) / AQITable[i].pRange + AQITable[i].aqMin;
+  return (uint16_t)aqi;
+}
+
+int main() {
+  constexpr uint16_t LastShared = 250;  // Both use the same breakpoints up to here
+  constexpr uint16_t Highest = 600;
+
+  int mismatches = 0, intended = 0;
+  for (uint16_t pm25 = 0; pm25 <= Highest; pm25++) {
+    uint16_t expected = referenceAQI(pm25);
+    uint16_t actual = DerivedAQI::aqiForPM25(pm25);
+    if (actual == expected) continue;
+    if (pm25 > LastShared) { intended++; continue; }
+    printf("pm25 %3u: table %3u, reference %3u\n", pm25, actual, expected);
+    mismatches++;
+  }
+
+  printf("Compared 0..%u ug/m3: %d mismatches, %d intended differences above %u ug/m3\n",
+      Highest, mismatches, intended, LastShared);
+  printf("e.g. 300 ug/m3: table %u, reference %u\n",
+      DerivedAQI::aqiForPM25(300), referenceAQI(300));
+  return mismatches ? 1 : 0;
+}
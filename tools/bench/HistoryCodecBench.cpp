@@ -0,0 +1,213 @@
+/*
+ * HistoryCodecBench
+ *    Host-side benchmark of the compressed history: how many samples each
+ *    range holds in its memory, and how fast ColumnStore encodes and
+ *    decodes rows
+ *
+ * NOTES:
+ * o This is not part of the sketch. Build and run it on the host with:
+ *     g++ -std=c++11 -O2 -o /tmp/HistoryCodecBench \
+ *       tools/bench/HistoryCodecBench.cpp src/history/History.cpp \
+ *       src/history/ColumnStore.cpp
+ *     /tmp/HistoryCodecBench
+ * o A year and a month of synthetic readings arrive every 10 seconds, as
+ *   they do on the device: PM2.5 with a daily cycle, noise, and a smoke
+ *   event every nine days that climbs into the unhealthy range;
+ *   temperature and humidity with daily and seasonal cycles; and slowly
+ *   drifting pressure. The AQI, NowCast, and EPA
+ *   corrected PM2.5 are derived from those. --noisy makes every value
+ *   several times noisier, as a worst case.
+ * o For each range the report compares the memory the compressed samples
+ *   occupy with what an array of History::Sample would need for the same
+ *   number of samples. That is the saving over an uncompressed copy of
+ *   the app's history, not memory freed on the device: the blocks are a
+ *   fixed allocation (sizeof(History) is reported), and AQIMgr's and
+ *   WeatherMgr's own histories are still allocated alongside them. Build
+ *   with -DESP8266 for the ESP8266's block counts.
+ * o Before timing anything, the bench checks that every row decodes to
+ *   exactly what was appended. It does so for the week range's samples,
+ *   for rows of random values at irregular times (which exercise the
+ *   escapes), and for both with so few blocks that the oldest are dropped
+ *   many times over. It exits with an error if any row differs.
+ * o Throughput is measured on the week range's samples, appended to and
+ *   decoded from a store large enough to hold all of them.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+//                                  Local Includes
+#include "../../src/history/History.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+  constexpr uint32_t Start = 1700006400;      // Midnight UTC
+  constexpr uint32_t Step = 10;               // Seconds between readings
+  constexpr uint32_t Days = 400;
+  constexpr int Iterations = 200;
+
+  // EPA breakpoints, as in src/data/DerivedAQI
+  uint16_t aqiFor(float pm) {
+    static const float bp[][4] = {
+      {0.0f, 12.0f, 0, 50}, {12.1f, 35.4f, 51, 100}, {35.5f, 55.4f, 101, 150},
+      {55.5f, 150.4f, 151, 200}, {150.5f, 250.4f, 201, 300}, {250.5f, 500.4f, 301, 500}};
+    for (auto& b : bp) {
+      if (pm <= b[1]) return lroundf(b[2] + (pm - b[0]) * (b[3] - b[2]) / (b[1] - b[0]));
+    }
+    return 500;
+  }
+
+  void generate(History& h, float noise) {
+    std::mt19937 rng(42);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    float pressure = 1013.0f, nowCast = 0;
+
+    for (uint32_t ts = Start; ts < Start + Days*24*60*60; ts += Step) {
+      float day = (ts % 86400) / 86400.0f;
+      float hours = (ts - Start) / 3600.0f;
+
+      float season = cosf(2 * M_PI * hours / (365 * 24));
+
+      float pm = 8 + 4 * sinf(2 * M_PI * (day - 0.3f));
+      float d = (fmodf(hours, 9 * 24) - 30) / 3;     // Smoke events
+      pm += 60 * expf(-d * d);
+      pm = fmaxf(0, pm + 1.5f * noise * gauss(rng));
+      float temp = 15 - 10 * season - 6 * cosf(2 * M_PI * (day - 0.1f)) +
+          0.1f * noise * gauss(rng);
+      float humi = 60 + 20 * cosf(2 * M_PI * (day - 0.1f)) + 0.5f * noise * gauss(rng);
+      pressure += 0.01f * noise * gauss(rng);
+
+      uint16_t aqi = aqiFor(pm);
+      nowCast += (aqi - nowCast) * Step / (3 * 3600.0f);
+      float epa = fmaxf(0, 0.524f * pm - 0.0862f * humi + 5.75f);
+
+      h.addAQI(ts, aqi, lroundf(nowCast));
+      h.addPM25(ts, lroundf(pm * 10), lroundf(epa * 10));
+      h.addWeather(ts, temp, humi, pressure);
+      h.loop(ts);
+    }
+  }
+
+  const char* rangeName(History::Range r) {
+    static const char* names[History::NRanges] = {"hour", "day", "week", "month", "year"};
+    return names[r];
+  }
+
+  // Appends rows to a store of nBlocks blocks and checks that what it
+  // returns is exactly the newest size() rows, in order
+  bool roundTrips(const char* name, const std::vector<ColumnStore::Row>& rows,
+      uint8_t nChannels, uint32_t unit, uint8_t nBlocks) {
+    static uint8_t buf[64 * 1024];
+    constexpr uint16_t BlockSize = 256;
+    ColumnStore store;
+    store.begin(nChannels, unit, buf, BlockSize, nBlocks);
+    std::vector<ColumnStore::Row> accepted;
+    for (const ColumnStore::Row& row : rows) {
+      if (store.append(row)) accepted.push_back(row);
+    }
+
+    uint32_t n = store.size();
+    bool ok = accepted.size() == rows.size() && n > 0 && n <= rows.size();
+    size_t i = rows.size() - n;
+    ColumnStore::Cursor c = store.rowsAfter(0);
+    ColumnStore::Row row;
+    uint32_t decoded = 0;
+    while (ok && c.next(row)) {
+      const ColumnStore::Row& want = accepted[i++];
+      ok = row.ts == want.ts && memcmp(row.v, want.v, nChannels * sizeof(row.v[0])) == 0;
+      decoded++;
+    }
+    ok = ok && decoded == n;
+    printf("round trip %-8s %2u blocks: %6zu appended, %6u held, %s\n",
+      name, nBlocks, rows.size(), n, ok ? "ok" : "MISMATCH");
+    return ok;
+  }
+
+  // Rows of uniformly random values at irregular times, with runs of a
+  // missing value sentinel
+  std::vector<ColumnStore::Row> randomRows(uint32_t n, uint32_t unit) {
+    std::mt19937 rng(7);
+    std::vector<ColumnStore::Row> rows(n);
+    uint32_t ts = Start;
+    for (uint32_t i = 0; i < n; i++) {
+      uint32_t r = rng();
+      ts += unit * ((r % 50 == 0) ? 1 + rng() % 1000 : 1 + r % 3);
+      rows[i].ts = ts;
+      bool missing = (i / 20) % 7 == 0;
+      for (uint16_t& v : rows[i].v) v = missing ? 0xffff : rng();
+    }
+    return rows;
+  }
+
+  template <typename Fn> double nsPer(uint32_t n, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Iterations; i++) fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / Iterations / n;
+  }
+}
+
+int main(int argc, char** argv) {
+  float noise = (argc > 1 && strcmp(argv[1], "--noisy") == 0) ? 4.0f : 1.0f;
+  static History h;
+  generate(h, noise);
+
+  printf("%-6s %8s %8s %8s %8s %8s %8s %10s %12s\n",
+    "range", "period", "in span", "wanted", "held", "bytes", "B/sample", "Sample[]", "vs Sample[]");
+  std::vector<ColumnStore::Row> rows;
+  for (uint8_t r = 0; r < History::NRanges; r++) {
+    History::Range range = (History::Range)r;
+    History::Sample s;
+    uint32_t n = 0;
+    History::Cursor c = h.samplesAfter(range, 0);
+    while (c.next(s)) {
+      n++;
+      if (range == History::Week) {
+        ColumnStore::Row row = {s.ts, {s.aqi, s.nowCast, (uint16_t)s.temp, s.humi,
+            s.pressure, s.pm25, s.pm25Epa, s.aqiMin, s.aqiMax, (uint16_t)s.tempMin,
+            (uint16_t)s.tempMax, s.humiMin, s.humiMax, s.count}};
+        rows.push_back(row);
+      }
+    }
+    uint32_t held = h.samplesHeld(range);
+    size_t bytes = h.bytesUsed(range);
+    size_t raw = held * sizeof(History::Sample);
+    printf("%-6s %8u %8u %8u %8u %8zu %8.2f %10zu %11.1fx\n",
+      rangeName(range), h.period(range), n, h.span(range) / h.period(range),
+      held, bytes, (double)bytes / held, raw, (double)raw / bytes);
+  }
+
+  printf("\nsizeof(History) %zu bytes\n\n", sizeof(History));
+
+  std::vector<ColumnStore::Row> random = randomRows(20000, 15*60);
+  bool ok = roundTrips("week", rows, 14, 15*60, 255);
+  ok &= roundTrips("week", rows, 14, 15*60, 3);
+  ok &= roundTrips("random", random, 14, 15*60, 255);
+  ok &= roundTrips("random", random, 14, 15*60, 4);
+  if (!ok) return 1;
+
+  // Throughput, with every row landing in one large store
+  static uint8_t buf[64 * 1024];
+  ColumnStore store;
+  double encode = nsPer(rows.size(), [&]() {
+    store.begin(14, 15*60, buf, 1024, sizeof(buf) / 1024);
+    for (const ColumnStore::Row& row : rows) store.append(row);
+  });
+  uint32_t sink = 0;
+  double decode = nsPer(rows.size(), [&]() {
+    ColumnStore::Cursor c = store.rowsAfter(0);
+    ColumnStore::Row row;
+    while (c.next(row)) sink += row.v[0];
+  });
+  printf("\nencode %.1f ns/row, decode %.1f ns/row over %zu rows (%u)\n",
+    encode, decode, rows.size(), sink & 1);
+  return 0;
+}
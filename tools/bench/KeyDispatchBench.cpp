@@ -0,0 +1,132 @@
+/*
+ * KeyDispatchBench
+ *    Host-side microbenchmark comparing the original if/else chain used by
+ *    PHDataSupplier::dataSupplier with the compile-time perfect hash table
+ *    from src/util/PerfectHash.h
+ *
+ * NOTES:
+ * o This is not part of the sketch. Build and run it on the host with:
+ *     g++ -std=c++11 -O2 -o /tmp/KeyDispatchBench tools/bench/KeyDispatchBench.cpp
+ *     /tmp/KeyDispatchBench
+ * o The readings and value formatting are stand-ins for AQIReadings and
+ *   Arduino's String. Both dispatchers do identical work once a key has been
+ *   resolved so the difference is the cost of resolving the key.
+ * o Results are reported per key since the point of the table is that every
+ *   key costs the same, whereas the chain gets slower the further down the
+ *   key is. The exception is the first key in the chain ("aqi"), which
+ *   the chain resolves with a single compare and so is cheaper there than
+ *   hashing it.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+//                                  Local Includes
+#include "../../src/util/PerfectHash.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+struct Readings {
+  uint32_t timestamp;
+  struct { uint16_t pm10, pm25, pm100; } standard, env;
+  uint16_t particles_03um, particles_05um, particles_10um;
+  uint16_t particles_25um, particles_50um, particles_100um;
+};
+
+static void emit(uint32_t v, std::string& val) { val.append(std::to_string(v)); }
+
+// ----- The original dispatch, transliterated
+static void chainSupplier(const std::string& key, const Readings& r, std::string& val) {
+  if (key == "aqi")           emit(r.env.pm25 * 2, val);
+  else if (key == "pm10std")  emit(r.standard.pm10, val);
+  else if (key == "pm25std")  emit(r.standard.pm25, val);
+  else if (key == "pm100std") emit(r.standard.pm100, val);
+  else if (key == "pm10env")  emit(r.env.pm10, val);
+  else if (key == "pm25env")  emit(r.env.pm25, val);
+  else if (key == "pm100env") emit(r.env.pm100, val);
+  else if (key == "p03")      emit(r.particles_03um, val);
+  else if (key == "p05")      emit(r.particles_05um, val);
+  else if (key == "p10")      emit(r.particles_10um, val);
+  else if (key == "p25")      emit(r.particles_25um, val);
+  else if (key == "p50")      emit(r.particles_50um, val);
+  else if (key == "p100")     emit(r.particles_100um, val);
+  else if (key == "tmst")     emit(r.timestamp, val);
+}
+
+// ----- The table-driven dispatch, mirroring PHDataSupplier.cpp
+namespace Table {
+  using ValueFn = void (*)(const Readings& r, std::string& val);
+  struct Entry { char key[12]; ValueFn value; };
+
+  void aqi(const Readings& r, std::string& v)      { emit(r.env.pm25 * 2, v); }
+  void pm10std(const Readings& r, std::string& v)  { emit(r.standard.pm10, v); }
+  void pm25std(const Readings& r, std::string& v)  { emit(r.standard.pm25, v); }
+  void pm100std(const Readings& r, std::string& v) { emit(r.standard.pm100, v); }
+  void pm10env(const Readings& r, std::string& v)  { emit(r.env.pm10, v); }
+  void pm25env(const Readings& r, std::string& v)  { emit(r.env.pm25, v); }
+  void pm100env(const Readings& r, std::string& v) { emit(r.env.pm100, v); }
+  void p03(const Readings& r, std::string& v)  { emit(r.particles_03um, v); }
+  void p05(const Readings& r, std::string& v)  { emit(r.particles_05um, v); }
+  void p10(const Readings& r, std::string& v)  { emit(r.particles_10um, v); }
+  void p25(const Readings& r, std::string& v)  { emit(r.particles_25um, v); }
+  void p50(const Readings& r, std::string& v)  { emit(r.particles_50um, v); }
+  void p100(const Readings& r, std::string& v) { emit(r.particles_100um, v); }
+  void tmst(const Readings& r, std::string& v) { emit(r.timestamp, v); }
+
+  constexpr Entry Entries[] PROGMEM = {
+    {"aqi", aqi}, {"pm10std", pm10std}, {"pm25std", pm25std}, {"pm100std", pm100std},
+    {"pm10env", pm10env}, {"pm25env", pm25env}, {"pm100env", pm100env},
+    {"p03", p03}, {"p05", p05}, {"p10", p10}, {"p25", p25}, {"p50", p50},
+    {"p100", p100}, {"tmst", tmst}
+  };
+  constexpr auto Keys PROGMEM = PerfectHash::makeTable<32>(Entries, PerfectHash::FNVOffset + 13);
+  static_assert(Keys.isPerfect(), "Keys collide");
+
+  void supplier(const std::string& key, const Readings& r, std::string& val) {
+    Entry e;
+    if (Keys.find(key.c_str(), e)) e.value(r, val);
+  }
+}
+
+typedef void (*Supplier)(const std::string&, const Readings&, std::string&);
+
+static double nsPerLookup(Supplier s, const std::string& key, const Readings& r) {
+  constexpr int Iterations = 2000000;
+  std::string val;
+  val.reserve(32);
+  size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Iterations; i++) {
+    val.clear();
+    s(key, r, val);
+    sink += val.size();
+  }
+  auto end = std::chrono::steady_clock::now();
+  if (sink == 0 && key != "none") printf("(no output for %s)\n", key.c_str());
+  return std::chrono::duration<double, std::nano>(end - start).count() / Iterations;
+}
+
+int main() {
+  Readings r = { 123456, {5, 9, 12}, {6, 10, 14}, 900, 300, 80, 10, 3, 1 };
+  const char* keys[] = {
+    "aqi", "pm10std", "pm25std", "pm100std", "pm10env", "pm25env", "pm100env",
+    "p03", "p05", "p10", "p25", "p50", "p100", "tmst", "none"
+  };
+
+  printf("%-10s %12s %12s\n", "key", "chain (ns)", "table (ns)");
+  double chainTotal = 0, tableTotal = 0;
+  for (const char* k : keys) {
+    std::string key(k);
+    double chain = nsPerLookup(chainSupplier, key, r);
+    double table = nsPerLookup(Table::supplier, key, r);
+    chainTotal += chain; tableTotal += table;
+    printf("%-10s %12.1f %12.1f\n", k, chain, table);
+  }
+  size_t n = sizeof(keys)/sizeof(keys[0]);
+  printf("%-10s %12.1f %12.1f\n", "mean", chainTotal/n, tableTotal/n);
+  return 0;
+}
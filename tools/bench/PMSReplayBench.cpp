@@ -0,0 +1,239 @@
+/*
+ * PMSReplayBench
+ *    Host-side replay harness and throughput benchmark for the PMS5003
+ *    ingestion path (PMS5003Link, PMS5003Parser, SensorStream)
+ *
+ * NOTES:
+ * o This is not part of the sketch. Build and run it on the host with:
+ *     g++ -std=c++11 -O2 -Itools/bench/host -o /tmp/PMSReplayBench \
+ *       tools/bench/PMSReplayBench.cpp src/sensors/PMS5003Link.cpp \
+ *       src/sensors/PMS5003Parser.cpp src/sensors/FrameAggregator.cpp
+ *     /tmp/PMSReplayBench --generate 100000 /tmp/pms.bin
+ *     /tmp/PMSReplayBench /tmp/pms.bin
+ * o The input is a raw capture of the bytes a sensor sent, e.g. recorded
+ *   with a USB serial adapter. Use "-" to read from stdin or a pipe.
+ *   --generate writes a synthetic capture with occasional corrupted frames
+ *   and line noise so that the resync paths are exercised as well.
+ * o By default bytes are replayed as fast as they can be parsed. With
+ *   --realtime they become available at the sensor's 9600 baud, which is
+ *   what the device sees.
+ * o The link is driven the way the ESP32 build drives it: a producer drains
+ *   the device into the ring and the consumer parses the ring. Each frame
+ *   is folded into a FrameAggregator, as the app does. Latency is
+ *   measured from the drain that delivered a frame's last byte to the
+ *   frame handler. Heap allocations are counted over the whole replay.
+ * o AQIMgr can only take readings by parsing frames from a Stream, so each
+ *   reading the app presents is encoded into SensorStream and parsed again.
+ *   The cost of that round trip is measured separately, with a second
+ *   PMS5003Parser standing in for AQIMgr's. On the device only one reading
+ *   per aggregation interval is presented, so the cost is paid at most
+ *   once a second and usually once a minute.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <vector>
+//                                  Local Includes
+#include "../../src/sensors/PMS5003Link.h"
+#include "../../src/sensors/FrameAggregator.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+// ----- Allocation counting
+static bool countingAllocations = false;
+static uint64_t allocations = 0;
+
+void* operator new(size_t size) {
+  if (countingAllocations) allocations++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+
+static uint64_t nowNanos() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+// A Stream over a file or pipe. In realtime mode a byte only becomes
+// available once enough time has passed for it to have arrived.
+class ReplayStream : public Stream {
+public:
+  static constexpr double BytesPerSecond = 9600 / 10.0;   // 8N1
+
+  ReplayStream(FILE* f, bool realtime) : f(f), realtime(realtime) { }
+
+  bool finished() { return fill() == 0; }
+  uint64_t bytesRead() const { return consumed; }
+
+  virtual int available() override {
+    size_t n = fill();
+    if (!realtime) return n;
+    if (!startNanos) startNanos = nowNanos();
+    double arrived = (nowNanos() - startNanos) * BytesPerSecond / 1e9;
+    int64_t allowed = (int64_t)arrived - (int64_t)consumed;
+    return (int)std::max<int64_t>(0, std::min<int64_t>(allowed, n));
+  }
+  virtual int read() override {
+    if (fill() == 0) return -1;
+    consumed++;
+    return buf[pos++];
+  }
+  virtual int peek() override { return fill() ? buf[pos] : -1; }
+  virtual size_t write(uint8_t) override { return 1; }   // Sensor commands go nowhere
+
+private:
+  FILE* f;
+  bool realtime;
+  uint8_t buf[4096];
+  size_t pos = 0;
+  size_t len = 0;
+  uint64_t consumed = 0;
+  uint64_t startNanos = 0;
+
+  size_t fill() {
+    if (pos == len) { pos = 0; len = fread(buf, 1, sizeof(buf), f); }
+    return len - pos;
+  }
+};
+
+
+static int generate(long frames, const char* path) {
+  FILE* out = fopen(path, "wb");
+  if (!out) { perror(path); return 1; }
+  srand(1);
+  uint8_t frame[PMS5003Parser::FrameSize];
+  for (long i = 0; i < frames; i++) {
+    uint16_t pm25 = 5 + (i / 60) % 40 + rand() % 5;
+    AQIReadings r = {};
+    r.standard.pm10 = pm25 * 2 / 3;  r.standard.pm25 = pm25;  r.standard.pm100 = pm25 + 3;
+    r.env.pm10 = r.standard.pm10;    r.env.pm25 = pm25;       r.env.pm100 = r.standard.pm100;
+    r.particles_03um = pm25 * 120;   r.particles_05um = pm25 * 40;  r.particles_10um = pm25 * 8;
+    r.particles_25um = pm25;         r.particles_50um = pm25 / 4;   r.particles_100um = pm25 / 10;
+    PMS5003Parser::encode(r, frame);
+    if (i % 97 == 13) frame[rand() % PMS5003Parser::FrameSize] ^= 0x10;  // Corrupt a frame
+    fwrite(frame, 1, sizeof(frame), out);
+    if (i % 53 == 7) {                                                    // Line noise
+      for (int n = rand() % 8; n > 0; n--) fputc(rand() & 0xff, out);
+    }
+  }
+  fclose(out);
+  printf("Wrote %ld frames to %s\n", frames, path);
+  return 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+    "usage: PMSReplayBench [--realtime] CAPTURE|-\n"
+    "       PMSReplayBench --generate FRAMES OUTPUT\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  bool realtime = false;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--generate") == 0) {
+      if (i + 2 >= argc) usage();
+      return generate(atol(argv[i+1]), argv[i+2]);
+    }
+    else if (strcmp(argv[i], "--realtime") == 0) realtime = true;
+    else if (!path) path = argv[i];
+    else usage();
+  }
+  if (!path) usage();
+
+  FILE* f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+  if (!f) { perror(path); return 1; }
+
+  ReplayStream device(f, realtime);
+  static PMS5003Link link;
+  static FrameAggregator aggregator;
+  std::vector<uint32_t> latencies;
+  latencies.reserve(1 << 20);
+  uint64_t lastDrain = 0;
+  uint64_t pm25Total = 0;
+
+  link.attach(&device, true);
+  link.setFrameHandler([&](const AQIReadings& r) {
+    uint64_t latency = nowNanos() - lastDrain;
+    if (latencies.size() < latencies.capacity()) latencies.push_back(latency);
+    pm25Total += r.env.pm25;
+    if (aggregator.add(r)) link.present(aggregator.summary().median);
+    else if (!aggregator.hasSummary()) link.present(r);
+  });
+
+  countingAllocations = true;
+  uint64_t start = nowNanos();
+  while (!device.finished()) {
+    lastDrain = nowNanos();
+    link.drain();
+    link.loop();
+    if (realtime) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  link.loop();
+  uint64_t elapsed = nowNanos() - start;
+  countingAllocations = false;
+
+  // The second parse: present a reading and read it back out of the
+  // SensorStream as AQIMgr would
+  constexpr uint32_t RoundTrips = 1000000;
+  PMS5003Parser reparser;
+  AQIReadings reading = aggregator.summary().median;
+  uint32_t reparsed = 0;
+  uint64_t roundTripStart = nowNanos();
+  for (uint32_t i = 0; i < RoundTrips; i++) {
+    reading.env.pm25 = i & 0x3ff;
+    link.present(reading);
+    Stream* s = link.stream();
+    int b;
+    while ((b = s->read()) >= 0) {
+      if (reparser.consume(b, i)) reparsed += reparser.readings().env.pm25 & 1;
+    }
+  }
+  double roundTrip = (double)(nowNanos() - roundTripStart) / RoundTrips;
+
+  PMS5003Link::Stats stats = link.stats();
+  uint64_t bytes = device.bytesRead();
+  if (f != stdin) fclose(f);
+
+  std::sort(latencies.begin(), latencies.end());
+  auto pct = [&](double p) -> uint32_t {
+    return latencies.empty() ? 0 : latencies[(size_t)(p * (latencies.size() - 1))];
+  };
+  double seconds = elapsed / 1e9;
+  double mean = 0;
+  for (uint32_t l : latencies) mean += l;
+  if (!latencies.empty()) mean /= latencies.size();
+
+  printf("Mode:            %s\n", realtime ? "realtime (9600 baud)" : "unbounded");
+  printf("Bytes:           %llu\n", (unsigned long long)bytes);
+  printf("Frames accepted: %u\n", stats.framesAccepted);
+  printf("Checksum errors: %u\n", stats.checksumErrors);
+  printf("Sync errors:     %u\n", stats.syncErrors);
+  printf("Resyncs:         %u\n", stats.resyncs);
+  printf("Overflow bytes:  %u\n", stats.overflowBytes);
+  printf("Elapsed:         %.3f s\n", seconds);
+  printf("Throughput:      %.0f frames/s, %.1f MB/s\n",
+    stats.framesAccepted / seconds, bytes / seconds / 1e6);
+  printf("Latency (ns):    min %u, mean %.0f, p50 %u, p99 %u, max %u\n",
+    pct(0), mean, pct(0.5), pct(0.99), pct(1));
+  printf("Allocations:     %llu (%.3f per frame)\n", (unsigned long long)allocations,
+    stats.framesAccepted ? (double)allocations / stats.framesAccepted : 0.0);
+  printf("Mean PM2.5:      %.2f\n", stats.framesAccepted ? (double)pm25Total / stats.framesAccepted : 0.0);
+  printf("Second parse:    %.0f ns per presented reading (%u)\n", roundTrip, reparsed & 1);
+  return 0;
+}
@@ -0,0 +1,268 @@
+/*
+ * PageRenderBench
+ *    Host-side microbenchmark comparing the per-request template processing
+ *    done by WebUI::wrapWebPage with PageTemplate's compile-once, render-many
+ *    approach, using the real page templates from data/
+ *
+ * NOTES:
+ * o This is not part of the sketch. Build and run it on the host with:
+ *     g++ -std=c++11 -O2 -Itools/bench/host -o /tmp/PageRenderBench \
+ *       tools/bench/PageRenderBench.cpp src/web/PageTemplate.cpp
+ *     /tmp/PageRenderBench data/HomePage.html data/ChartPage.html data/ConfigForm.html
+ * o The new path is the real src/web/PageTemplate.cpp, built against the
+ *   stand-ins in tools/bench/host.
+ * o wrapWebPage hands the template to ESPTemplateProcessor, which is part of
+ *   WebThing and can't be built here. It reads the file one byte at a time,
+ *   collects each %KEY% into a String and passes it to a mapper lambda that
+ *   tries the Mappers functions in turn. That is transliterated below, with
+ *   the mapper chains in the order the original pages used. Keys that were
+ *   added to the templates later are appended to the end of each chain.
+ * o Both paths read the same in-memory files through the host ESP_FS and
+ *   send through the same WebUI::sendContent(), so the cost of the flash
+ *   filesystem is not modeled; on the device the byte-at-a-time reads of
+ *   the old path cost considerably more than they do here.
+ * o Both renderers emit the same value for every key, and the bench checks
+ *   that their output is byte-for-byte identical before timing them.
+ * o Heap allocations are counted for one render of each page. The single
+ *   allocation PageTemplate makes is the host ESP_FS::open() copying the
+ *   path into a std::string. On the device opening the file allocates its
+ *   handle instead (at least one allocation, more on some filesystems), so
+ *   a render there is not allocation-free either.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+//                                  Host Stand-ins
+#include <Arduino.h>
+#include <ESP_FS.h>
+#include <WebUI.h>
+//                                  Local Includes
+#include "../../src/util/Writer.h"
+#include "../../src/web/PageTemplate.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+// ----- Allocation counting
+static bool countingAllocations = false;
+static uint64_t allocations = 0;
+
+void* operator new(size_t size) {
+  if (countingAllocations) allocations++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+
+// ----- Page output
+static std::string page;
+void WebUI::sendContent(const String& content) { page.append(content.c_str(), content.length()); }
+
+static const char* valueFor(const std::string& key) {
+  // Every key gets a short, plausible value. What matters is that both
+  // renderers produce the same one.
+  return (key.size() & 1) ? "12.3" : "true";
+}
+
+
+// ----- The original path, transliterated
+namespace Original {
+  // A mapper is a list of keys, any of which ending in '*' match by prefix
+  // the way the AG<n>/WG<n> graph range keys did
+  using Mapper = std::vector<std::string>;
+  using Chain = std::vector<const Mapper*>;
+
+  const Mapper PHSettings = {
+    "DESC", "AIO_KEY", "AIO_USER", "AIO_GROUP", "I_BRIGHT", "LAT", "LNG",
+    "GMAPS_KEY", "CITYID", "WEATHER_KEY", "UNITS", "VLTG"
+  };
+  const Mapper HasWeather = { "HAS_TEMP", "HAS_HUMI" };
+  const Mapper HasAQI = { "HAS_AQI" };
+  const Mapper WeatherReadings = {
+    "TEMP", "HUMI", "BARO", "RELP", "HTIN", "DWPT", "DPSP", "W_TMST"
+  };
+  const Mapper AQIReadings = {
+    "AQI", "PM10STD", "PM25STD", "PM100STD", "PM10ENV", "PM25ENV", "PM100ENV",
+    "P03", "P05", "P10", "P25", "P50", "P100", "TMST"
+  };
+  const Mapper AQISettings = { "AQI_CLR", "AG*" };
+  const Mapper WeatherSettings = {
+    "TEMP_CORRECT", "HUMI_CORRECT", "RAW_TEMP", "RAW_HUMI", "TEMP", "HUMI",
+    "TEMP_CLR", "HUMI_CLR", "WG*"
+  };
+  const Mapper Later = {
+    "NOWCAST", "EVENTS_PORT", "USE_METRIC", "AM*", "TEMP_GAIN", "HUMI_GAIN",
+    "PRES_CORRECT", "PRES_GAIN", "PM10_CORRECT", "PM10_GAIN", "PM25_CORRECT",
+    "PM25_GAIN", "PM100_CORRECT", "PM100_GAIN"
+  };
+
+  const Chain HomeChain = {
+    &PHSettings, &HasWeather, &HasAQI, &WeatherReadings, &AQIReadings, &Later
+  };
+  const Chain SettingsChain = {
+    &HasAQI, &HasWeather, &AQISettings, &WeatherSettings, &PHSettings, &Later
+  };
+
+  bool matches(const std::string& key, const std::string& entry) {
+    if (entry.back() == '*') return key.compare(0, entry.size() - 1, entry, 0, entry.size() - 1) == 0;
+    return key == entry;
+  }
+
+  void map(const Chain& chain, const std::string& key, std::string& val) {
+    for (const Mapper* m : chain) {
+      for (const std::string& entry : *m) {
+        if (matches(key, entry)) { val = valueFor(key); return; }
+      }
+    }
+  }
+
+  // ESPTemplateProcessor::send
+  void render(const char* path, const Chain& chain) {
+    constexpr size_t BufferSize = 100;
+    constexpr size_t MaxKeyLength = 32;
+    File file = ESP_FS::open(path, "r");
+    char buffer[BufferSize+1];
+    size_t bufferLen = 0;
+    auto emit = [&](char c) {
+      buffer[bufferLen++] = c;
+      if (bufferLen == BufferSize) {
+        buffer[bufferLen] = '\0';
+        WebUI::sendContent(String(buffer));
+        bufferLen = 0;
+      }
+    };
+
+    int val;
+    while ((val = file.read()) != -1) {
+      char ch = (char)val;
+      if (ch == '\\') {
+        if ((val = file.read()) != -1) emit((char)val);
+      } else if (ch == '%') {
+        uint32_t pos = file.position();
+        std::string key;
+        bool found = false;
+        while ((val = file.read()) != -1 && key.size() < MaxKeyLength) {
+          if (val == '%') { found = true; break; }
+          key += (char)val;
+        }
+        if (!found) { emit('%'); file.seek(pos); continue; }
+        std::string processed;
+        map(chain, key, processed);
+        for (char c : processed) emit(c);
+      } else {
+        emit(ch);
+      }
+    }
+    if (bufferLen) {
+      buffer[bufferLen] = '\0';
+      WebUI::sendContent(String(buffer));
+    }
+  }
+}
+
+
+// ----- The values PageTemplate renders
+namespace Values {
+  // Stands in for the table of (key, function, argument) entries in PHWebUI
+  std::vector<std::string> keys;
+  uint32_t rendered = 0;    // Values rendered, i.e. placeholders in the page
+
+  uint8_t resolve(const char* key) {
+    for (size_t i = 0; i < keys.size(); i++) if (keys[i] == key) return i;
+    keys.push_back(key);
+    return keys.size() - 1;
+  }
+
+  void value(uint8_t id, Writer& out) {
+    rendered++;
+    out.print(valueFor(keys[id]));
+  }
+}
+
+
+template <typename Fn>
+static double usPerCall(Fn fn) {
+  constexpr int Iterations = 20000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Iterations; i++) { page.clear(); fn(); }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() / Iterations;
+}
+
+template <typename Fn>
+static uint64_t allocationsPerCall(Fn fn) {
+  page.clear();
+  allocations = 0;
+  countingAllocations = true;
+  fn();
+  countingAllocations = false;
+  return allocations;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s template.html...\n", argv[0]);
+    return 1;
+  }
+  page.reserve(64*1024);
+
+  printf("%-24s %8s %6s %14s %14s %14s %8s %8s\n",
+      "page", "bytes", "keys", "original (us)", "render (us)", "compile (us)",
+      "allocs", "allocs");
+  printf("%-24s %8s %6s %14s %14s %14s %8s %8s\n",
+      "", "", "", "", "", "", "original", "render");
+  for (int i = 1; i < argc; i++) {
+    std::ifstream in(argv[i], std::ios::binary);
+    if (!in) { fprintf(stderr, "Unable to open %s\n", argv[i]); return 1; }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const char* path = argv[i];
+    ESP_FS::addFile(path, ss.str());
+
+    // Only the home page used the readings mappers first
+    bool home = strstr(path, "HomePage") != nullptr;
+    const Original::Chain& chain = home ? Original::HomeChain : Original::SettingsChain;
+
+    PageTemplate t;
+    if (!t.compile(path, Values::resolve)) {
+      fprintf(stderr, "%s: compile failed\n", path);
+      return 1;
+    }
+
+    page.clear(); Original::render(path, chain);
+    std::string expected = page;
+    Values::rendered = 0;
+    page.clear(); t.render(Values::value);
+    if (page != expected) {
+      fprintf(stderr, "%s: output differs (%zu vs %zu bytes)\n", path, expected.size(), page.size());
+      return 1;
+    }
+    uint32_t nKeys = Values::rendered;
+
+    double original = usPerCall([&]() { Original::render(path, chain); });
+    double rendered = usPerCall([&]() { t.render(Values::value); });
+    double compiled = usPerCall([&]() { PageTemplate c; c.compile(path, Values::resolve); });
+    uint64_t originalAllocs = allocationsPerCall([&]() { Original::render(path, chain); });
+    uint64_t renderAllocs = allocationsPerCall([&]() { t.render(Values::value); });
+
+    const char* name = strrchr(path, '/');
+    printf("%-24s %8u %6u %14.1f %14.1f %14.1f %8llu %8llu\n",
+        name ? name + 1 : path, (unsigned)ESP_FS::files()[path].size(), nKeys,
+        original, rendered, compiled,
+        (unsigned long long)originalAllocs, (unsigned long long)renderAllocs);
+  }
+  return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Arduino.h (host)
+ *    Just enough of the Arduino core to build the sensor ingestion and web
+ *    page code on the host. Used by the benchmarks in tools/bench; not part
+ *    of the sketch.
+ *
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "WString.h"
+
+inline unsigned long micros() {
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+inline unsigned long millis() { return micros() / 1000; }
+
+#define F(s) (s)
+#define PROGMEM
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+
+class Print {
+public:
+  virtual ~Print() { }
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buf, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buf++);
+    return n;
+  }
+  virtual void flush() { }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+#endif  // Arduino_h
@@ -0,0 +1,23 @@
+/*
+ * ArduinoLog.h (host)
+ *    A logger that discards everything, so that code which logs can be
+ *    built on the host. Used by the benchmarks in tools/bench; not part of
+ *    the sketch.
+ *
+ */
+
+#ifndef ArduinoLog_h
+#define ArduinoLog_h
+
+class LogClass {
+public:
+  template <typename... Args> void error(Args...) { }
+  template <typename... Args> void warning(Args...) { }
+  template <typename... Args> void notice(Args...) { }
+  template <typename... Args> void trace(Args...) { }
+  template <typename... Args> void verbose(Args...) { }
+};
+
+static LogClass Log;
+
+#endif  // ArduinoLog_h
@@ -0,0 +1,67 @@
+/*
+ * ESP_FS.h (host)
+ *    A read-only, in-memory stand-in for WebThing's ESP_FS, so that code
+ *    which reads files can be built on the host. Used by the benchmarks in
+ *    tools/bench; not part of the sketch.
+ *
+ * NOTES:
+ * o Files are supplied by the benchmark with ESP_FS::addFile(), which has
+ *   no counterpart on the device. Reads are served from memory, so the
+ *   cost of the flash filesystem is not modeled.
+ *
+ */
+
+#ifndef ESP_FS_h
+#define ESP_FS_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+
+class File {
+public:
+  File() { }
+  explicit File(const std::string* data) : data(data) { }
+
+  explicit operator bool() const { return data != nullptr; }
+
+  int available() const { return data ? data->size() - pos : 0; }
+  int read() { return (pos < data->size()) ? (uint8_t)(*data)[pos++] : -1; }
+  size_t read(uint8_t* buf, size_t size) {
+    size = std::min(size, data->size() - pos);
+    memcpy(buf, data->data() + pos, size);
+    pos += size;
+    return size;
+  }
+  bool seek(uint32_t p) { pos = std::min((size_t)p, data->size()); return pos == p; }
+  uint32_t position() const { return pos; }
+  uint32_t size() const { return data->size(); }
+  void close() { data = nullptr; }
+
+private:
+  const std::string* data = nullptr;
+  size_t pos = 0;
+};
+
+namespace ESP_FS {
+  inline std::map<std::string, std::string>& files() {
+    static std::map<std::string, std::string> theFiles;
+    return theFiles;
+  }
+
+  // Host only: makes contents readable at path
+  inline void addFile(const char* path, const std::string& contents) { files()[path] = contents; }
+
+  inline bool exists(const char* path) { return files().count(path) != 0; }
+
+  inline File open(const char* path, const char* mode) {
+    auto f = files().find(path);
+    if (mode[0] != 'r' || f == files().end()) return File();
+    return File(&f->second);
+  }
+}
+
+#endif  // ESP_FS_h
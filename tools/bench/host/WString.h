@@ -0,0 +1,30 @@
+/*
+ * WString.h (host)
+ *    Just enough of Arduino's String to build the web page code on the host.
+ *    Used by the benchmarks in tools/bench; not part of the sketch.
+ *
+ */
+
+#ifndef WString_h
+#define WString_h
+
+#include <stddef.h>
+#include <string>
+
+class String {
+public:
+  String() { }
+  String(const char* s) : s(s) { }
+
+  bool reserve(size_t size) { s.reserve(size); return true; }
+  bool concat(const char* data, size_t len) { s.append(data, len); return true; }
+  void remove(size_t index) { if (index < s.size()) s.resize(index); }
+
+  size_t length() const { return s.size(); }
+  const char* c_str() const { return s.c_str(); }
+
+private:
+  std::string s;
+};
+
+#endif  // WString_h
@@ -0,0 +1,18 @@
+/*
+ * WebUI.h (host)
+ *    The part of WebThing's WebUI that page rendering sends its output
+ *    through. The benchmark that uses it supplies sendContent(). Used by
+ *    the benchmarks in tools/bench; not part of the sketch.
+ *
+ */
+
+#ifndef WebUI_h
+#define WebUI_h
+
+#include "WString.h"
+
+namespace WebUI {
+  void sendContent(const String& content);
+}
+
+#endif  // WebUI_h
@@ -0,0 +1,24 @@
+/*
+ * AQIMgr.h (host)
+ *    The AQIReadings type from WebThing's AQIMgr, for host builds of the
+ *    sensor ingestion code. Used by the benchmarks in tools/bench.
+ *
+ */
+
+#ifndef AQIMgr_h
+#define AQIMgr_h
+
+#include <stdint.h>
+
+typedef struct {
+  uint16_t pm10, pm25, pm100;
+} PMReadings;
+
+typedef struct {
+  uint32_t timestamp;
+  PMReadings standard, env;
+  uint16_t particles_03um, particles_05um, particles_10um;
+  uint16_t particles_25um, particles_50um, particles_100um;
+} AQIReadings;
+
+#endif  // AQIMgr_h